@@ -1,15 +1,19 @@
 #pragma once
 #include "Demographics.h"
 #include "SEDPNR.h"
+#include <algorithm>
 #include <cmath>
 #include <map>
+#include <memory_resource>
 #include <random>
 #include <vector>
 
 #include "Configuration.h"
 #include "SEDPNR.h"
+#include "SimParams.h"
 
-// Note: Configurable parameters are now managed by Configuration::instance()
+// Note: Hot-loop helpers take the frozen SimParams block; construction-time
+// values still read Configuration::instance()
 
 // Agent class follows...
 
@@ -35,26 +39,32 @@ public:
   // Derived values
   double credibilityValue; // Calculated from age + education
 
+  // Containers below allocate from the memory resource passed to the
+  // constructor (City's RunArena pool during a run)
+
   // Social network
-  std::vector<int> connections; // IDs of connected agents
+  std::pmr::vector<int> connections; // IDs of connected agents
 
   // SEDPNR states per claim (claim_id -> state)
-  std::map<int, SEDPNRState> claimStates;
+  std::pmr::map<int, SEDPNRState> claimStates;
 
   // Time spent in current state per claim (for state transitions)
-  std::map<int, int> timeInState;
+  std::pmr::map<int, int> timeInState;
 
   // Connection tenure: tracks steps since agent became Propagating while
   // connection stayed Susceptible. Key: connection ID, Value: steps
-  std::map<int, int> connectionTenure;
+  std::pmr::map<int, int> connectionTenure;
 
   // Constructor
   Agent(int agentId, int agentAge, int eduLevel, int town, int school,
         int religious, int work, EthnicGroup ethnic,
-        ReligiousDenomination denom)
+        ReligiousDenomination denom,
+        std::pmr::memory_resource *mem = std::pmr::get_default_resource())
       : id(agentId), age(agentAge), educationLevel(eduLevel), homeTownId(town),
         schoolLocationId(school), religiousLocationId(religious),
-        workplaceLocationId(work), ethnicity(ethnic), denomination(denom) {
+        workplaceLocationId(work), ethnicity(ethnic), denomination(denom),
+        connections(mem), claimStates(mem), timeInState(mem),
+        connectionTenure(mem) {
     credibilityValue = calculateCredibility();
   }
 
@@ -114,6 +124,21 @@ public:
     return score;
   }
 
+  // Bit mask of the similarity bonuses shared with another agent, indexing
+  // SimParams::similarityWeight (bit 0 ethnicity, 1 religion, 2 age, 3 edu)
+  int similarityMask(const Agent &other) const {
+    int mask = 0;
+    if (ethnicity == other.ethnicity)
+      mask |= 1;
+    if (denomination == other.denomination)
+      mask |= 2;
+    if (std::abs(age - other.age) <= 10)
+      mask |= 4;
+    if (std::abs(educationLevel - other.educationLevel) <= 1)
+      mask |= 8;
+    return mask;
+  }
+
   // ========================================================================
   // GET AGE GROUP
   // ========================================================================
@@ -136,8 +161,16 @@ public:
   // PLACEHOLDER IMPLEMENTATION - Returns base probability due to placeholder
   // params
   // ========================================================================
-  double getInteractionProbability(const Agent &other) const {
-    auto &cfg = Configuration::instance();
+  double getInteractionProbability(const Agent &other,
+                                   const SimParams &cfg) const {
+    return getInteractionProbability(other, cfg,
+                                     getAgeGroup() == other.getAgeGroup());
+  }
+
+  // Variant for callers that already know whether the age groups match
+  // (City keeps age groups in a dense per-agent array)
+  double getInteractionProbability(const Agent &other, const SimParams &cfg,
+                                   bool sameAgeGroup) const {
     double prob = cfg.base_interaction_prob;
 
     // Location-based interaction
@@ -163,7 +196,7 @@ public:
     }
 
     // Age group factor - same age group interacts more
-    if (getAgeGroup() == other.getAgeGroup()) {
+    if (sameAgeGroup) {
       prob += cfg.age_group_weight;
     }
 
@@ -233,13 +266,20 @@ public:
     return SEDPNRState::SUSCEPTIBLE; // Default state
   }
 
-  // Set state for a claim
-  void setState(int claimId, SEDPNRState state) {
-    if (claimStates.find(claimId) == claimStates.end() ||
-        claimStates[claimId] != state) {
+  // Set state for a claim; returns the previous state
+  SEDPNRState setState(int claimId, SEDPNRState state) {
+    auto it = claimStates.find(claimId);
+    if (it == claimStates.end()) {
       timeInState[claimId] = 0; // Reset time when state changes
+      claimStates.emplace(claimId, state);
+      return SEDPNRState::SUSCEPTIBLE;
+    }
+    SEDPNRState previous = it->second;
+    if (previous != state) {
+      timeInState[claimId] = 0;
+      it->second = state;
     }
-    claimStates[claimId] = state;
+    return previous;
   }
 
   // Increment time in current state
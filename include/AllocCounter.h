@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// ============================================================================
+// ALLOCATION COUNTER
+// With SIM_COUNT_ALLOCS defined (make COUNT_ALLOCS=1) this header replaces
+// the global operator new/delete with counting versions, so a run can check
+// that steady-state step() performs no heap allocations. The replacements
+// are definitions: include this header from exactly one translation unit
+// (src/main.cpp).
+// ============================================================================
+
+struct AllocCounter {
+  static size_t &count() {
+    static size_t n = 0;
+    return n;
+  }
+  static size_t &bytes() {
+    static size_t n = 0;
+    return n;
+  }
+};
+
+#ifdef SIM_COUNT_ALLOCS
+
+inline void *countedAlloc(std::size_t size) {
+  AllocCounter::count()++;
+  AllocCounter::bytes() += size;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+inline void *countedAlignedAlloc(std::size_t size, std::align_val_t al) {
+  AllocCounter::count()++;
+  AllocCounter::bytes() += size;
+  std::size_t align = static_cast<std::size_t>(al);
+  std::size_t rounded = (size + align - 1) / align * align;
+  if (void *p = std::aligned_alloc(align, rounded ? rounded : align))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void *operator new(std::size_t size, std::align_val_t al) {
+  return countedAlignedAlloc(size, al);
+}
+void *operator new[](std::size_t size, std::align_val_t al) {
+  return countedAlignedAlloc(size, al);
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// ============================================================================
+// RUN ARENA
+// Memory for structures that live for the whole run (agent state maps,
+// connection lists, location names and member lists). A monotonic arena
+// takes large blocks from the heap and never frees them individually; a
+// pool on top recycles freed nodes, so steady-state map inserts/erases and
+// vector regrowth do not reach operator new. Everything is released in one
+// go when the arena is destroyed.
+// ============================================================================
+
+// Pass-through resource that counts the bytes it hands out
+class CountingResource : public std::pmr::memory_resource {
+public:
+  explicit CountingResource(std::pmr::memory_resource *up) : upstream(up) {}
+
+  size_t bytesAllocated() const { return allocated; }
+  size_t blocksAllocated() const { return blocks; }
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    allocated += bytes;
+    blocks++;
+    return upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+    allocated -= bytes;
+    upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource *upstream;
+  size_t allocated = 0;
+  size_t blocks = 0;
+};
+
+class RunArena {
+public:
+  static constexpr size_t INITIAL_BLOCK = 1 << 20; // 1 MB, grows geometrically
+
+  RunArena()
+      : heap(std::pmr::new_delete_resource()), arena(INITIAL_BLOCK, &heap),
+        pool(&arena) {}
+
+  RunArena(const RunArena &) = delete;
+  RunArena &operator=(const RunArena &) = delete;
+
+  std::pmr::memory_resource *resource() { return &pool; }
+
+  // Heap bytes currently held by the arena (its whole footprint)
+  size_t bytesReserved() const { return heap.bytesAllocated(); }
+  size_t heapBlocks() const { return heap.blocksAllocated(); }
+
+private:
+  // Declaration order = construction order: heap <- arena <- pool
+  CountingResource heap;
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::unsynchronized_pool_resource pool;
+};
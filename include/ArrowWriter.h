@@ -0,0 +1,551 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// ARROW IPC WRITER
+// Self-contained writer for the Arrow IPC file format (Feather v2), so that
+// pandas/polars/pyarrow can memory-map simulation outputs instead of
+// parsing CSV. A file is the magic "ARROW1", a schema message, dictionary
+// and record batch messages, and a footer locating them. Messages are
+// flatbuffers (built by FlatBuilder below, no flatbuffers dependency)
+// followed by a body of 8-byte aligned buffers. Supported columns are
+// non-null int8/16/32, bool and dictionary-encoded strings with int16
+// indices; dictionary values may grow between batches (delta
+// dictionaries). Little-endian hosts only, like the rest of the outputs.
+// ============================================================================
+
+namespace arrow_detail {
+
+// Minimal flatbuffer builder. The buffer is built back to front, as in the
+// reference implementation: children are written before their parents, so
+// every offset is known when it is written. Objects are identified by
+// their distance from the end of the buffer; bytes are kept in reverse
+// order and flipped by finish()
+class FlatBuilder {
+public:
+  using Ref = uint32_t;
+
+  Ref size() const { return static_cast<Ref>(rev.size()); }
+
+  // Start a new buffer, keeping the capacity of the last one
+  void clear() {
+    rev.clear();
+    fields.clear();
+    tableStart = 0;
+    minAlign = 1;
+  }
+
+  void reserve(size_t bytes, size_t tableFields) {
+    rev.reserve(bytes);
+    fields.reserve(tableFields);
+  }
+
+  // Pad so that `extra` more bytes end on an `align` boundary
+  void prep(size_t align, size_t extra) {
+    minAlign = std::max(minAlign, align);
+    size_t pad = (align - (rev.size() + extra) % align) % align;
+    rev.insert(rev.end(), pad, 0);
+  }
+
+  void bytes(const void *p, size_t n) {
+    const uint8_t *b = static_cast<const uint8_t *>(p);
+    for (size_t i = n; i-- > 0;)
+      rev.push_back(b[i]);
+  }
+
+  template <typename T> void scalar(T v) {
+    prep(sizeof(T), 0);
+    bytes(&v, sizeof(T));
+  }
+
+  void offset(Ref target) {
+    prep(4, 0);
+    scalar<uint32_t>(size() + 4 - target);
+  }
+
+  Ref string(const std::string &s) {
+    prep(4, s.size() + 1);
+    rev.push_back(0);
+    bytes(s.data(), s.size());
+    scalar<uint32_t>(static_cast<uint32_t>(s.size()));
+    return size();
+  }
+
+  Ref offsets(const std::vector<Ref> &refs) {
+    prep(4, 4 * refs.size());
+    for (size_t i = refs.size(); i-- > 0;)
+      offset(refs[i]);
+    scalar<uint32_t>(static_cast<uint32_t>(refs.size()));
+    return size();
+  }
+
+  // Vector of structs, given as raw little-endian bytes
+  template <typename T> Ref structs(const std::vector<T> &items) {
+    size_t n = items.size() * sizeof(T);
+    prep(4, n);
+    prep(alignof(T), n);
+    bytes(items.data(), n);
+    scalar<uint32_t>(static_cast<uint32_t>(items.size()));
+    return size();
+  }
+
+  void startTable() {
+    fields.clear();
+    tableStart = size();
+  }
+  template <typename T> void field(int slot, T v) {
+    scalar(v);
+    fields.push_back({slot, size()});
+  }
+  void fieldOffset(int slot, Ref target) {
+    offset(target);
+    fields.push_back({slot, size()});
+  }
+
+  // Write the table's vtable right in front of it
+  Ref endTable() {
+    int slots = 0;
+    for (const auto &f : fields)
+      slots = std::max(slots, f.slot + 1);
+    uint16_t vtableBytes = static_cast<uint16_t>(2 * (2 + slots));
+    scalar<int32_t>(vtableBytes); // The vtable sits vtableBytes before
+    Ref table = size();
+    for (int s = slots; s-- > 0;) {
+      uint16_t at = 0;
+      for (const auto &f : fields)
+        if (f.slot == s)
+          at = static_cast<uint16_t>(table - f.at);
+      bytes(&at, 2);
+    }
+    uint16_t tableBytes = static_cast<uint16_t>(table - tableStart);
+    bytes(&tableBytes, 2);
+    bytes(&vtableBytes, 2);
+    return table;
+  }
+
+  // Flip the finished buffer into out (reusing its capacity)
+  void finish(Ref root, std::vector<uint8_t> &out) {
+    prep(minAlign, 4);
+    offset(root);
+    out.assign(rev.rbegin(), rev.rend());
+  }
+
+private:
+  struct Field {
+    int slot;
+    Ref at;
+  };
+  std::vector<uint8_t> rev;
+  std::vector<Field> fields;
+  Ref tableStart = 0;
+  size_t minAlign = 1;
+};
+
+// Structs of Schema.fbs, Message.fbs and File.fbs
+struct FieldNode {
+  int64_t length;
+  int64_t nullCount;
+};
+struct BufferRef {
+  int64_t offset;
+  int64_t length;
+};
+struct Block {
+  int64_t offset;
+  int32_t metaDataLength;
+  int32_t pad;
+  int64_t bodyLength;
+};
+
+// Union tags and enums
+constexpr uint8_t TYPE_INT = 2;
+constexpr uint8_t TYPE_UTF8 = 5;
+constexpr uint8_t TYPE_BOOL = 6;
+constexpr uint8_t HEADER_SCHEMA = 1;
+constexpr uint8_t HEADER_DICTIONARY_BATCH = 2;
+constexpr uint8_t HEADER_RECORD_BATCH = 3;
+constexpr int16_t METADATA_V5 = 4;
+
+inline size_t pad8(size_t n) { return (n + 7) & ~size_t(7); }
+
+} // namespace arrow_detail
+
+enum class ArrowType : uint8_t { INT8, INT16, INT32, BOOL, DICT_UTF8 };
+
+struct ArrowField {
+  std::string name;
+  ArrowType type;
+};
+
+class ArrowFileWriter {
+public:
+  ArrowFileWriter() = default;
+  ArrowFileWriter(const ArrowFileWriter &) = delete;
+  ArrowFileWriter &operator=(const ArrowFileWriter &) = delete;
+  ~ArrowFileWriter() { close(); }
+
+  // Create the file and write the schema; false if it cannot be created.
+  // Batches of up to batchRows rows, and up to `batches` of them, are then
+  // written without allocating
+  bool open(const std::string &path, const std::vector<ArrowField> &schema,
+            size_t batchRows = 0, size_t batches = 0) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+      return false;
+    fields = schema;
+    columns.assign(fields.size(), {});
+    bits.assign(fields.size(), {});
+    dictionaries.assign(fields.size(), {});
+    dictionaryBlocks.clear();
+    batchBlocks.clear();
+    at = 0;
+    failed = false;
+    reserve(batchRows, batches);
+    put("ARROW1\0\0", 8);
+    message(
+        arrow_detail::HEADER_SCHEMA,
+        [&](arrow_detail::FlatBuilder &fb) { return schemaTable(fb); }, 0);
+    body.clear();
+    writeMessage(meta, body);
+    return !failed;
+  }
+
+  bool isOpen() const { return file != nullptr; }
+
+  // Append one value to a column of the pending batch; bool columns take
+  // 0/1 and dictionary columns take the value's index
+  template <typename T> void append(size_t column, T value) {
+    std::vector<uint8_t> &c = columns[column];
+    switch (fields[column].type) {
+    case ArrowType::INT8:
+    case ArrowType::BOOL:
+      c.push_back(static_cast<uint8_t>(value));
+      break;
+    case ArrowType::INT16:
+    case ArrowType::DICT_UTF8:
+      push(c, static_cast<int16_t>(value));
+      break;
+    case ArrowType::INT32:
+      push(c, static_cast<int32_t>(value));
+      break;
+    }
+  }
+
+  // Rows appended since the last batch (columns must be appended evenly)
+  size_t pendingRows() const {
+    return columns.empty() ? 0 : columns[0].size() / width(fields[0].type);
+  }
+
+  // Add values to a dictionary column; written before the next batch
+  void addDictionaryValues(size_t column,
+                           const std::vector<std::string> &values) {
+    Dictionary &d = dictionaries[column];
+    d.pending.insert(d.pending.end(), values.begin(), values.end());
+  }
+
+  // Write the pending rows as one record batch (nothing if empty)
+  bool writeBatch() {
+    if (!file)
+      return false;
+    writeDictionaries();
+    size_t rows = pendingRows();
+    if (rows == 0)
+      return !failed;
+    body.clear();
+    nodes.clear();
+    for (size_t k = 0; k < fields.size(); ++k) {
+      nodes.push_back({static_cast<int64_t>(rows), 0});
+      body.add(nullptr, 0); // No validity bitmap: no nulls
+      if (fields[k].type == ArrowType::BOOL) {
+        std::vector<uint8_t> &b = bits[k];
+        b.assign((rows + 7) / 8, 0);
+        for (size_t i = 0; i < rows; ++i)
+          b[i / 8] |= static_cast<uint8_t>((columns[k][i] & 1) << (i % 8));
+        body.add(b.data(), b.size());
+      } else {
+        body.add(columns[k].data(), columns[k].size());
+      }
+    }
+    message(
+        arrow_detail::HEADER_RECORD_BATCH,
+        [&](arrow_detail::FlatBuilder &fb) {
+          return recordBatchTable(fb, rows, nodes, body.refs);
+        },
+        body.bytes);
+    batchBlocks.push_back(writeMessage(meta, body));
+    for (auto &c : columns)
+      c.clear();
+    return !failed;
+  }
+
+  // Write any pending rows and the footer; returns false if any write
+  // failed since open()
+  bool close() {
+    if (!file)
+      return false;
+    writeBatch();
+    const uint32_t eos[2] = {0xFFFFFFFFu, 0};
+    put(eos, sizeof(eos));
+
+    arrow_detail::FlatBuilder &fb = builder;
+    fb.clear();
+    auto dicts = fb.structs(dictionaryBlocks);
+    auto batches = fb.structs(batchBlocks);
+    auto schema = schemaTable(fb);
+    fb.startTable();
+    fb.field<int16_t>(0, arrow_detail::METADATA_V5);
+    fb.fieldOffset(1, schema);
+    fb.fieldOffset(2, dicts);
+    fb.fieldOffset(3, batches);
+    fb.finish(fb.endTable(), meta);
+    put(meta.data(), meta.size());
+    int32_t footerBytes = static_cast<int32_t>(meta.size());
+    put(&footerBytes, 4);
+    put("ARROW1", 6);
+
+    bool ok = !failed && std::fclose(file) == 0;
+    file = nullptr;
+    return ok;
+  }
+
+  void flush() {
+    if (file)
+      std::fflush(file);
+  }
+
+  // Drop the file without a footer or further writes (forked children
+  // that share the parent's descriptor; flush() before forking)
+  void abandon() {
+    if (file)
+      std::fclose(file);
+    file = nullptr;
+    columns.clear();
+  }
+
+private:
+  struct Dictionary {
+    bool sent = false;                // First batch written
+    std::vector<std::string> pending; // Values for the next batch
+  };
+
+  // Message body: buffers at 8-byte aligned offsets. Buffers are not
+  // copied; they must stay unchanged until writeMessage() has written them
+  struct Body {
+    std::vector<arrow_detail::BufferRef> refs;
+    std::vector<std::pair<const void *, size_t>> parts;
+    size_t bytes = 0; // Padded length
+
+    void clear() {
+      refs.clear();
+      parts.clear();
+      bytes = 0;
+    }
+
+    void add(const void *p, size_t n) {
+      refs.push_back({static_cast<int64_t>(bytes), static_cast<int64_t>(n)});
+      parts.push_back({p, n});
+      bytes += arrow_detail::pad8(n);
+    }
+  };
+
+  // Room for batches of batchRows rows: column and bitmap buffers, the
+  // body and node lists, the flatbuffer (two structs per field plus the
+  // fixed tables) and the file's block list
+  void reserve(size_t batchRows, size_t batches) {
+    for (size_t k = 0; k < fields.size(); ++k) {
+      columns[k].reserve(batchRows * width(fields[k].type));
+      if (fields[k].type == ArrowType::BOOL)
+        bits[k].reserve((batchRows + 7) / 8);
+    }
+    nodes.reserve(fields.size());
+    body.refs.reserve(2 * fields.size());
+    body.parts.reserve(2 * fields.size());
+    size_t metaBytes = 256 + 64 * fields.size();
+    builder.reserve(metaBytes, 8);
+    meta.reserve(metaBytes);
+    batchBlocks.reserve(batches);
+  }
+
+  static size_t width(ArrowType t) {
+    switch (t) {
+    case ArrowType::INT16:
+    case ArrowType::DICT_UTF8:
+      return 2;
+    case ArrowType::INT32:
+      return 4;
+    default:
+      return 1;
+    }
+  }
+
+  template <typename T> static void push(std::vector<uint8_t> &c, T v) {
+    size_t n = c.size();
+    c.resize(n + sizeof(T));
+    std::memcpy(c.data() + n, &v, sizeof(T));
+  }
+
+  void put(const void *p, size_t n) {
+    if (n > 0 && std::fwrite(p, 1, n, file) != n)
+      failed = true;
+    at += n;
+  }
+
+  // Encapsulated message: continuation marker, metadata length, metadata
+  // padded to 8 bytes, body
+  arrow_detail::Block writeMessage(const std::vector<uint8_t> &metadata,
+                                   const Body &messageBody) {
+    arrow_detail::Block block{static_cast<int64_t>(at), 0, 0,
+                              static_cast<int64_t>(messageBody.bytes)};
+    int32_t metaBytes =
+        static_cast<int32_t>(arrow_detail::pad8(metadata.size()));
+    const uint32_t marker = 0xFFFFFFFFu;
+    put(&marker, 4);
+    put(&metaBytes, 4);
+    put(metadata.data(), metadata.size());
+    static const uint8_t zeros[8] = {};
+    put(zeros, static_cast<size_t>(metaBytes) - metadata.size());
+    for (const auto &part : messageBody.parts) {
+      put(part.first, part.second);
+      put(zeros, arrow_detail::pad8(part.second) - part.second);
+    }
+    block.metaDataLength = 8 + metaBytes;
+    return block;
+  }
+
+  // Build a message's metadata into meta with the shared builder
+  template <typename Build>
+  void message(uint8_t headerType, Build header, size_t bodyBytes) {
+    arrow_detail::FlatBuilder &fb = builder;
+    fb.clear();
+    auto h = header(fb);
+    fb.startTable();
+    fb.field<int64_t>(3, static_cast<int64_t>(bodyBytes));
+    fb.fieldOffset(2, h);
+    fb.field<int16_t>(0, arrow_detail::METADATA_V5);
+    fb.field<uint8_t>(1, headerType);
+    fb.finish(fb.endTable(), meta);
+  }
+
+  static arrow_detail::FlatBuilder::Ref intType(arrow_detail::FlatBuilder &fb,
+                                                int bits) {
+    fb.startTable();
+    fb.field<int32_t>(0, bits);
+    fb.field<uint8_t>(1, 1); // is_signed
+    return fb.endTable();
+  }
+
+  arrow_detail::FlatBuilder::Ref schemaTable(arrow_detail::FlatBuilder &fb) {
+    std::vector<arrow_detail::FlatBuilder::Ref> refs;
+    for (size_t k = 0; k < fields.size(); ++k) {
+      const ArrowField &f = fields[k];
+      auto name = fb.string(f.name);
+      auto children = fb.offsets({});
+      arrow_detail::FlatBuilder::Ref type = 0, dictionary = 0;
+      uint8_t tag = arrow_detail::TYPE_INT;
+      if (f.type == ArrowType::BOOL || f.type == ArrowType::DICT_UTF8) {
+        tag = f.type == ArrowType::BOOL ? arrow_detail::TYPE_BOOL
+                                        : arrow_detail::TYPE_UTF8;
+        fb.startTable(); // Bool and Utf8 have no fields
+        type = fb.endTable();
+      } else {
+        type = intType(fb, static_cast<int>(8 * width(f.type)));
+      }
+      if (f.type == ArrowType::DICT_UTF8) {
+        auto index = intType(fb, 16);
+        fb.startTable();
+        fb.field<int64_t>(0, static_cast<int64_t>(k)); // Dictionary ID
+        fb.fieldOffset(1, index);
+        dictionary = fb.endTable();
+      }
+      fb.startTable();
+      fb.fieldOffset(0, name);
+      fb.fieldOffset(3, type);
+      if (dictionary)
+        fb.fieldOffset(4, dictionary);
+      fb.fieldOffset(5, children);
+      fb.field<uint8_t>(1, 0); // Not nullable
+      fb.field<uint8_t>(2, tag);
+      refs.push_back(fb.endTable());
+    }
+    auto list = fb.offsets(refs);
+    fb.startTable();
+    fb.fieldOffset(1, list);
+    fb.field<int16_t>(0, 0); // Little-endian
+    return fb.endTable();
+  }
+
+  static arrow_detail::FlatBuilder::Ref
+  recordBatchTable(arrow_detail::FlatBuilder &fb, size_t rows,
+                   const std::vector<arrow_detail::FieldNode> &nodes,
+                   const std::vector<arrow_detail::BufferRef> &buffers) {
+    auto nodeList = fb.structs(nodes);
+    auto bufferList = fb.structs(buffers);
+    fb.startTable();
+    fb.field<int64_t>(0, static_cast<int64_t>(rows));
+    fb.fieldOffset(1, nodeList);
+    fb.fieldOffset(2, bufferList);
+    return fb.endTable();
+  }
+
+  // One dictionary batch per dictionary column with new values: the first
+  // holds the initial values, later ones are deltas
+  void writeDictionaries() {
+    for (size_t k = 0; k < dictionaries.size(); ++k) {
+      Dictionary &d = dictionaries[k];
+      if (fields[k].type != ArrowType::DICT_UTF8 ||
+          (d.sent && d.pending.empty()))
+        continue;
+      std::vector<int32_t> offsets{0};
+      std::string chars;
+      for (const std::string &v : d.pending) {
+        chars += v;
+        offsets.push_back(static_cast<int32_t>(chars.size()));
+      }
+      body.clear();
+      body.add(nullptr, 0);
+      body.add(offsets.data(), offsets.size() * sizeof(int32_t));
+      body.add(chars.data(), chars.size());
+      size_t values = d.pending.size();
+      nodes.assign(1, {static_cast<int64_t>(values), 0});
+      bool delta = d.sent;
+      message(
+          arrow_detail::HEADER_DICTIONARY_BATCH,
+          [&](arrow_detail::FlatBuilder &fb) {
+            auto data = recordBatchTable(fb, values, nodes, body.refs);
+            fb.startTable();
+            fb.field<int64_t>(0, static_cast<int64_t>(k));
+            fb.fieldOffset(1, data);
+            fb.field<uint8_t>(2, delta ? 1 : 0);
+            return fb.endTable();
+          },
+          body.bytes);
+      dictionaryBlocks.push_back(writeMessage(meta, body));
+      d.sent = true;
+      d.pending.clear();
+    }
+  }
+
+  std::FILE *file = nullptr;
+  uint64_t at = 0; // Bytes written so far
+  bool failed = false;
+  std::vector<ArrowField> fields;
+  std::vector<std::vector<uint8_t>> columns; // Pending rows, column-major
+  std::vector<std::vector<uint8_t>> bits;    // Packed BOOL columns
+  std::vector<Dictionary> dictionaries;
+  std::vector<arrow_detail::Block> dictionaryBlocks;
+  std::vector<arrow_detail::Block> batchBlocks;
+
+  // Per-message scratch, reused so that writing a batch does not allocate
+  arrow_detail::FlatBuilder builder;
+  std::vector<uint8_t> meta;
+  Body body;
+  std::vector<arrow_detail::FieldNode> nodes;
+};
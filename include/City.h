@@ -1,14 +1,29 @@
 #pragma once
 
 #include "Agent.h"
+#include "Arena.h"
 #include "Configuration.h"
 #include "Location.h"
+#include "LocationRegistry.h"
+#include "MemoryReport.h"
+#include "SimParams.h"
 #include "Town.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
 #include <random>
 #include <vector>
 
+// Outcome of City::reorderAgents(): mean neighbour ID distance over all
+// connections under the current and the proposed numbering
+struct ReorderStats {
+  double meanDistanceBefore = 0.0;
+  double meanDistanceAfter = 0.0;
+  bool applied = false; // Agents were renumbered
+};
+
 // ============================================================================
 // CITY CLASS
 // Represents the simulation environment with towns, locations, and agents
@@ -19,17 +34,49 @@ public:
   // Towns in the city
   std::vector<Town> towns;
 
-  // All locations (flat list for quick lookup)
-  std::vector<Location *> allLocations;
+  // All locations, indexed by dense location ID, with their member lists
+  LocationRegistry locations;
 
   // Population
   std::vector<Agent> agents;
 
+  // Static per-agent attributes in dense arrays indexed by agent ID,
+  // computed once after population generation (buildAgentAttributes)
+  std::vector<AgeGroup> ageGroups;
+  std::vector<double> passingFrequency; // Agent::getClaimPassingFrequency()
+  std::vector<double> beliefMultiplier; // 0.5 + credibilityValue
+
+  // One bit per agent, set while it holds any non-Susceptible claim state.
+  // Maintained by setAgentState()
+  std::vector<uint64_t> involvedBits;
+
+  // Renumbering maps set by reorderAgents(): externalIds[id] is the
+  // generation-order ID, internalIds its inverse. Empty means identity
+  std::vector<int> externalIds;
+  std::vector<int> internalIds;
+
   // Random number generator
   std::mt19937 rng;
 
+  // Frozen parameters for network generation and rewiring
+  SimParams params;
+
   // Constructor
-  City(unsigned int seed = 42) : rng(seed) {}
+  City(unsigned int seed = 42,
+       const SimParams &p = SimParams::compile(Configuration::instance()))
+      : rng(seed), params(p), arena(std::make_unique<RunArena>()) {}
+
+  // Containers holding arena memory must be destroyed before the arena.
+  // Member-wise moves are safe because the arena is declared last.
+  ~City() {
+    agents.clear();
+    towns.clear();
+    locations = LocationRegistry();
+  }
+  City(City &&) = default;
+  City &operator=(City &&) = default;
+
+  std::pmr::memory_resource *memoryResource() { return arena->resource(); }
 
   // ========================================================================
   // TOWN GENERATION
@@ -38,24 +85,16 @@ public:
   void generateTowns() {
     auto &cfg = Configuration::instance();
     towns.clear();
-    allLocations.clear();
+    locations.clear(cfg.num_towns);
 
+    towns.reserve(cfg.num_towns);
     for (int i = 0; i < cfg.num_towns; ++i) {
       towns.emplace_back(i, cfg.schools_per_town, cfg.religious_per_town,
                          cfg.workplaces_per_town, cfg.school_capacity,
-                         cfg.religious_capacity, cfg.workplace_capacity);
-
-      // Build flat location list
-      for (auto &school : towns[i].schools) {
-        allLocations.push_back(&school);
-      }
-      for (auto &religious : towns[i].religiousEstablishments) {
-        allLocations.push_back(&religious);
-      }
-      for (auto &work : towns[i].workplaces) {
-        allLocations.push_back(&work);
-      }
+                         cfg.religious_capacity, cfg.workplace_capacity,
+                         locations, memoryResource());
     }
+    locations.finalizeSites();
   }
 
   // ========================================================================
@@ -66,6 +105,7 @@ public:
     auto &cfg = Configuration::instance();
     agents.clear();
     agents.reserve(populationSize);
+    candidateScratch.reserve(populationSize);
 
     std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
     std::uniform_int_distribution<int> townDist(0, cfg.num_towns - 1);
@@ -82,21 +122,14 @@ public:
       int townId = townDist(rng);
 
       // Assign to a school (All people are assigned as requested)
-      int schoolId = -1;
-      Location *school = towns[townId].getRandomSchool(rng);
-      if (school && school->assignAgent(i)) {
-        schoolId = school->id;
-      }
+      int schoolId = locations.assignRandom(rng, townId, LocationType::SCHOOL);
 
       // Assign to a religious establishment (probabilistic matching
       // denomination)
       int religiousId = -1;
       if (denomination != ReligiousDenomination::NONE) {
-        Location *religious =
-            towns[townId].getRandomReligiousOfDenomination(rng, denomination);
-        if (religious && religious->assignAgent(i)) {
-          religiousId = religious->id;
-        }
+        religiousId = locations.assignRandom(
+            rng, townId, LocationType::RELIGIOUS_ESTABLISHMENT, denomination);
       }
 
       // Assign to a workplace (based on education level)
@@ -108,18 +141,70 @@ public:
         if (!towns[townId].workplaces.empty()) {
           int numWork = towns[townId].workplaces.size();
           // Deterministic but distributed mapping from education to workplace
-          // subset
+          // subset; spills to another open workplace when that one is full
           int workplaceIdx = (education * 2 + (i % 2)) % numWork;
-          Location *work = &towns[townId].workplaces[workplaceIdx];
-          if (work->assignAgent(i)) {
-            workplaceId = work->id;
-          }
+          workplaceId = locations.assignPreferred(
+              rng, towns[townId].workplaces[workplaceIdx]);
         }
       }
 
       agents.emplace_back(i, age, education, townId, schoolId, religiousId,
-                          workplaceId, ethnicity, denomination);
+                          workplaceId, ethnicity, denomination,
+                          memoryResource());
     }
+
+    locations.buildMembers(agents);
+    if (locations.overflowAssignments > 0) {
+      std::cerr << "Warning: " << locations.overflowAssignments
+                << " agents placed over capacity (every matching site was "
+                   "full)"
+                << std::endl;
+    }
+
+    buildAgentAttributes();
+  }
+
+  // ========================================================================
+  // DENSE AGENT ATTRIBUTES
+  // ========================================================================
+  void buildAgentAttributes() {
+    size_t n = agents.size();
+    ageGroups.resize(n);
+    passingFrequency.resize(n);
+    beliefMultiplier.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      ageGroups[i] = agents[i].getAgeGroup();
+      passingFrequency[i] = agents[i].getClaimPassingFrequency();
+      beliefMultiplier[i] = 0.5 + agents[i].credibilityValue;
+    }
+
+    involvedBits.assign((n + 63) / 64, 0);
+    for (size_t i = 0; i < n; ++i) {
+      if (agents[i].isInvolved())
+        involvedBits[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+  }
+
+  // Is the agent in a non-Susceptible state for any claim? O(1)
+  bool isInvolved(int agentId) const {
+    return (involvedBits[agentId >> 6] >> (agentId & 63)) & 1;
+  }
+
+  // Set an agent's claim state and keep the involvement mask in sync.
+  // All state changes during a run should go through here. Returns the
+  // previous state
+  SEDPNRState setAgentState(int agentId, int claimId, SEDPNRState state) {
+    Agent &agent = agents[agentId];
+    SEDPNRState previous = agent.setState(claimId, state);
+
+    uint64_t bit = uint64_t(1) << (agentId & 63);
+    if (state != SEDPNRState::SUSCEPTIBLE) {
+      involvedBits[agentId >> 6] |= bit;
+    } else if ((involvedBits[agentId >> 6] & bit) && !agent.isInvolved()) {
+      // Only a reset back to Susceptible can clear involvement
+      involvedBits[agentId >> 6] &= ~bit;
+    }
+    return previous;
   }
 
   // ========================================================================
@@ -127,8 +212,6 @@ public:
   // Creates connections based on shared locations
   // ========================================================================
   void generateNetwork() {
-    auto &cfg = Configuration::instance();
-
     // Clear existing connections
     for (auto &agent : agents) {
       agent.connections.clear();
@@ -143,14 +226,15 @@ public:
         Agent &other = agents[j];
 
         // Calculate connection probability based on shared locations
-        double prob = agent.getInteractionProbability(other);
+        double prob = agent.getInteractionProbability(
+            other, params, ageGroups[i] == ageGroups[j]);
 
         // Create connection if probability check passes and haven't hit max
         if (probDist(rng) < prob) {
           if (static_cast<int>(agent.connections.size()) <
-                  cfg.max_connections &&
+                  params.max_connections &&
               static_cast<int>(other.connections.size()) <
-                  cfg.max_connections) {
+                  params.max_connections) {
             agent.connections.push_back(other.id);
             other.connections.push_back(agent.id);
           }
@@ -159,6 +243,138 @@ public:
     }
   }
 
+  // ========================================================================
+  // LOCALITY-PRESERVING RENUMBERING
+  // Agent IDs follow generation order, so neighbours can end up scattered
+  // across the agents vector. reorderAgents() computes a reverse
+  // Cuthill-McKee order of the network, visiting components and each BFS
+  // frontier by home town, then primary hub (school, else workplace, else
+  // religious site), then degree. The new numbering is applied only if it
+  // brings neighbours closer (mean ID distance over all connections);
+  // agents' containers are then copied into the arena in the new order,
+  // connections, dense attributes and member lists are rewritten, and
+  // externalIds keeps the generation-order ID that output files report.
+  // Returns both distances and whether the agents were renumbered.
+  // ========================================================================
+  ReorderStats reorderAgents() {
+    ReorderStats stats;
+    size_t n = agents.size();
+    if (n == 0)
+      return stats;
+
+    auto primaryHub = [](const Agent &a) {
+      if (a.schoolLocationId >= 0)
+        return a.schoolLocationId;
+      if (a.workplaceLocationId >= 0)
+        return a.workplaceLocationId;
+      return a.religiousLocationId;
+    };
+    auto visitsFirst = [&](int a, int b) {
+      const Agent &x = agents[a], &y = agents[b];
+      if (x.homeTownId != y.homeTownId)
+        return x.homeTownId < y.homeTownId;
+      if (primaryHub(x) != primaryHub(y))
+        return primaryHub(x) < primaryHub(y);
+      if (x.connections.size() != y.connections.size())
+        return x.connections.size() < y.connections.size();
+      return a < b;
+    };
+
+    std::vector<int> seeds(n);
+    for (size_t i = 0; i < n; ++i)
+      seeds[i] = static_cast<int>(i);
+    std::sort(seeds.begin(), seeds.end(), visitsFirst);
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<char> visited(n, 0);
+    std::vector<int> frontier;
+    for (int seed : seeds) {
+      if (visited[seed])
+        continue;
+      visited[seed] = 1;
+      size_t head = order.size();
+      order.push_back(seed);
+      while (head < order.size()) {
+        int u = order[head++];
+        frontier.clear();
+        for (int v : agents[u].connections) {
+          if (!visited[v]) {
+            visited[v] = 1;
+            frontier.push_back(v);
+          }
+        }
+        std::sort(frontier.begin(), frontier.end(), visitsFirst);
+        order.insert(order.end(), frontier.begin(), frontier.end());
+      }
+    }
+    std::reverse(order.begin(), order.end());
+
+    std::vector<int> newId(n);
+    for (size_t k = 0; k < n; ++k)
+      newId[order[k]] = static_cast<int>(k);
+
+    // Keep the current numbering unless the new one is tighter
+    int64_t current = 0, proposed = 0, links = 0;
+    for (size_t i = 0; i < n; ++i) {
+      for (int c : agents[i].connections) {
+        current += std::abs(static_cast<int>(i) - c);
+        proposed += std::abs(newId[i] - newId[c]);
+        links++;
+      }
+    }
+    double scale = links > 0 ? 1.0 / links : 0.0;
+    stats.meanDistanceBefore = current * scale;
+    stats.meanDistanceAfter = proposed * scale;
+    if (proposed >= current)
+      return stats;
+    stats.applied = true;
+
+    // Fresh arena copies, laid out in the new order
+    std::vector<Agent> reordered;
+    reordered.reserve(n);
+    std::vector<int> external(n);
+    for (size_t k = 0; k < n; ++k) {
+      const Agent &src = agents[order[k]];
+      external[k] = externalId(src.id);
+      reordered.emplace_back(static_cast<int>(k), src.age, src.educationLevel,
+                             src.homeTownId, src.schoolLocationId,
+                             src.religiousLocationId, src.workplaceLocationId,
+                             src.ethnicity, src.denomination,
+                             memoryResource());
+      Agent &agent = reordered.back();
+      agent.connections.reserve(src.connections.size());
+      for (int c : src.connections)
+        agent.connections.push_back(newId[c]);
+      std::sort(agent.connections.begin(), agent.connections.end());
+      agent.claimStates = src.claimStates;
+      agent.timeInState = src.timeInState;
+      for (const auto &entry : src.connectionTenure)
+        agent.connectionTenure.emplace(newId[entry.first], entry.second);
+    }
+    agents.swap(reordered);
+    reordered.clear();
+
+    externalIds.swap(external);
+    internalIds.assign(n, 0);
+    for (size_t k = 0; k < n; ++k)
+      internalIds[externalIds[k]] = static_cast<int>(k);
+
+    buildAgentAttributes();
+    locations.buildMembers(agents);
+    return stats;
+  }
+
+  // Generation-order ID of an agent (identity unless reorderAgents() ran)
+  int externalId(int id) const {
+    return externalIds.empty() ? id : externalIds[id];
+  }
+
+  // Current ID of the agent generated as number ext
+  int internalId(int ext) const {
+    return internalIds.empty() ? ext : internalIds[ext];
+  }
+
   // ========================================================================
   // GETTERS
   // ========================================================================
@@ -178,7 +394,7 @@ public:
   std::vector<int> getAgentsByAgeGroup(AgeGroup group) const {
     std::vector<int> result;
     for (const auto &agent : agents) {
-      if (agent.getAgeGroup() == group) {
+      if (ageGroups[agent.id] == group) {
         result.push_back(agent.id);
       }
     }
@@ -204,19 +420,22 @@ public:
   // Get population size
   size_t getPopulationSize() const { return agents.size(); }
 
+  // Heap blocks the run arena has taken so far (it grows geometrically)
+  size_t arenaBlocks() const { return arena->heapBlocks(); }
+
   // Find a random new connection candidate for an agent
   // Returns -1 if no suitable candidate found
   int findRandomNewConnection(int agentId, int excludeId) {
-    auto &cfg = Configuration::instance();
     Agent &agent = agents[agentId];
 
     // Check if agent has room for more connections
-    if (static_cast<int>(agent.connections.size()) >= cfg.max_connections) {
+    if (static_cast<int>(agent.connections.size()) >= params.max_connections) {
       return -1;
     }
 
     // Build list of candidates (not self, not excludeId, not already connected)
-    std::vector<int> candidates;
+    std::vector<int> &candidates = candidateScratch;
+    candidates.clear();
     for (size_t i = 0; i < agents.size(); ++i) {
       int candidateId = static_cast<int>(i);
       if (candidateId == agentId || candidateId == excludeId)
@@ -235,7 +454,7 @@ public:
 
       // Check if candidate has room
       if (static_cast<int>(agents[candidateId].connections.size()) >=
-          cfg.max_connections)
+          params.max_connections)
         continue;
 
       candidates.push_back(candidateId);
@@ -249,6 +468,85 @@ public:
     return candidates[dist(rng)];
   }
 
+  // ========================================================================
+  // MEMORY ACCOUNTING
+  // Adds one entry per City/Town/Location/Agent structure to the report
+  // ========================================================================
+  void accountMemory(MemoryReport &report) const {
+    using namespace memsize;
+
+    size_t townPayload = payload(towns), townLive = heap(towns);
+    for (const auto &town : towns) {
+      townPayload += payload(town.name) + payload(town.schools) +
+                     payload(town.religiousEstablishments) +
+                     payload(town.workplaces);
+      townLive += heap(town.name) + heap(town.schools) +
+                  heap(town.religiousEstablishments) + heap(town.workplaces);
+    }
+
+    size_t namePayload = 0, nameLive = 0;
+    for (const auto &loc : locations.locations) {
+      namePayload += payload(loc.name);
+      nameLive += heap(loc.name);
+    }
+
+    report.add("City::towns", towns.size(), townPayload, townLive);
+    report.add("Registry::locations", locations.size(),
+               payload(locations.locations), heap(locations.locations));
+    report.add("Location::name", locations.size(), namePayload, nameLive);
+    report.add("Registry::members", locations.members.size(),
+               payload(locations.members) + payload(locations.memberOffsets),
+               heap(locations.members) + heap(locations.memberOffsets));
+    report.add("Registry::sitePools", locations.size(),
+               locations.poolBytes(), locations.poolBytes());
+
+    size_t connCount = 0, connPayload = 0, connLive = 0;
+    size_t stateCount = 0, statePayload = 0, stateLive = 0;
+    size_t timeCount = 0, timePayload = 0, timeLive = 0;
+    size_t tenureCount = 0, tenurePayload = 0, tenureLive = 0;
+    for (const auto &agent : agents) {
+      connCount += agent.connections.size();
+      connPayload += payload(agent.connections);
+      connLive += heap(agent.connections);
+      stateCount += agent.claimStates.size();
+      statePayload += payload(agent.claimStates);
+      stateLive += heap(agent.claimStates);
+      timeCount += agent.timeInState.size();
+      timePayload += payload(agent.timeInState);
+      timeLive += heap(agent.timeInState);
+      tenureCount += agent.connectionTenure.size();
+      tenurePayload += payload(agent.connectionTenure);
+      tenureLive += heap(agent.connectionTenure);
+    }
+
+    report.add("City::agents", agents.size(), payload(agents), heap(agents));
+    report.add("Agent::connections", connCount, connPayload, connLive);
+    report.add("Agent::claimStates", stateCount, statePayload, stateLive);
+    report.add("Agent::timeInState", timeCount, timePayload, timeLive);
+    report.add("Agent::connectionTenure", tenureCount, tenurePayload,
+               tenureLive);
+
+    report.add("City::agentAttributes", ageGroups.size(),
+               payload(ageGroups) + payload(passingFrequency) +
+                   payload(beliefMultiplier),
+               heap(ageGroups) + heap(passingFrequency) +
+                   heap(beliefMultiplier));
+    report.add("City::involvedBits", involvedBits.size(), payload(involvedBits),
+               heap(involvedBits));
+    report.add("City::idMaps", externalIds.size(),
+               payload(externalIds) + payload(internalIds),
+               heap(externalIds) + heap(internalIds));
+    report.add("City::candidateScratch", candidateScratch.size(),
+               payload(candidateScratch), heap(candidateScratch));
+
+    // Arena memory not attributed to any structure above (pool free lists,
+    // unused tail of the current arena block)
+    size_t pooled = nameLive + connLive + stateLive + timeLive + tenureLive;
+    size_t reserved = arena->bytesReserved();
+    report.add("City::runArena (unused)", arena->heapBlocks(), 0,
+               reserved > pooled ? reserved - pooled : 0);
+  }
+
 private:
   // ========================================================================
   // DEMOGRAPHIC GENERATION HELPERS
@@ -376,4 +674,11 @@ private:
     int edu = static_cast<int>(std::round(dist(rng)));
     return std::max(0, std::min(5, edu));
   }
+
+  // Reused by findRandomNewConnection so rewiring does not allocate
+  std::vector<int> candidateScratch;
+
+  // Run-lifetime memory for agents and locations; declared last so it
+  // outlives every container allocated from it
+  std::unique_ptr<RunArena> arena;
 };
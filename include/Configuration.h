@@ -2,9 +2,11 @@
 
 #include <fstream>
 #include <iostream>
-#include <map>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <variant>
+#include <vector>
 
 // ============================================================================
 // UNIFIED CONFIGURATION
@@ -63,17 +65,173 @@ struct Configuration {
   // Simulation Settings
   int output_interval = 1;
   bool full_spatial_snapshot = true; // Record all agents for visualization
+  bool local_counts = false; // Per-town/per-location counts (local_counts.csv)
+  bool demographic_counts = false; // Counts by demographic cell
+  bool spatial_index = true; // Companion index of spatial_data.csv (.idx)
+  bool arrow_output = false; // Arrow IPC copies of results and snapshots
+  int spatial_panel_size = 0;     // Agents written at every spatial record
+  int spatial_panel_strata = 0;   // 0 none, 1 by town, 2 by demographic cell
+  int spatial_reservoir_size = 0; // Agents drawn afresh at every record
+  // Steps between records of each output; 0 means output_interval
+  int spatial_interval = 0;
+  int local_counts_interval = 0;
+  int demographic_counts_interval = 0;
+  bool live_view = false;   // Publish every step to shared memory (--live)
+
+  // Hub mean-field exposure: adds an O(1) per-agent exposure term from the
+  // propagators at the agent's school, religious site and workplace
+  bool hub_exposure = false;
+  double hub_exposure_weight = 1.0; // Effective contacts per step at a hub
+
+  // Sparse agent-major engine for many simultaneous claims: stores only
+  // non-Susceptible (agent, claim) pairs and visits only active agents
+  bool sparse_engine = false;
+
+  // Draw transition randomness from per-(step, claim, agent) counter
+  // streams instead of one shared generator (order-independent results)
+  bool counter_rng = false;
+
+  // Renumber agents by town, hub and network neighbourhood after network
+  // generation so that neighbours share cache lines
+  bool reorder_agents = false;
+
+  // Worker processes for a town-partitioned run (1 = single process).
+  // More than 1 needs counter_rng=true and enable_connection_pruning,
+  // hub_exposure and sparse_engine off; other configs are rejected
+  int partitions = 1;
+
+  // Extra claims added after the two default ones (news-cycle runs)
+  int news_cycle_claims = 0;
+  int news_cycle_seeds = 3; // Initial propagators per extra claim
 
   // Connection Pruning
   bool enable_connection_pruning = true;
   int connection_patience = 50; // Steps before pruning unresponsive connection
 
+  // Memory accounting: re-measure structures every N steps (0 = only at
+  // the reports after initialize() and at the end of the run)
+  int memory_sample_interval = 50;
+
+  // Profiling (only takes effect in builds with PROFILE=1)
+  bool profile_step_breakdown = false; // Write per-step phase timings
+
   // Singleton access
   static Configuration &instance() {
     static Configuration config;
     return config;
   }
 
+  // ========================================================================
+  // PARAMETER SCHEMA
+  // Every key accepted in a .cfg file, bound to the field it sets. The
+  // field's type decides how the value is parsed and checked.
+  // ========================================================================
+  using Field = std::variant<int Configuration::*, unsigned int Configuration::*,
+                             double Configuration::*, bool Configuration::*>;
+
+  // applied=false: the key is recognised and its value checked, but the
+  // field keeps its default. The loader before the schema skipped these
+  // keys, so every run has used the defaults; applying them would change
+  // every run's output
+  struct ParamSpec {
+    const char *key;
+    Field field;
+    bool applied = true;
+  };
+
+  static const std::vector<ParamSpec> &schema() {
+    static const std::vector<ParamSpec> table = {
+        // Simulation Core
+        {"population", &Configuration::population},
+        {"timesteps", &Configuration::timesteps},
+        {"seed", &Configuration::seed},
+
+        // Town/Location Settings
+        {"num_towns", &Configuration::num_towns},
+        {"schools_per_town", &Configuration::schools_per_town},
+        {"religious_per_town", &Configuration::religious_per_town},
+        {"school_capacity", &Configuration::school_capacity},
+        {"religious_capacity", &Configuration::religious_capacity},
+        {"workplaces_per_town", &Configuration::workplaces_per_town},
+        {"workplace_capacity", &Configuration::workplace_capacity},
+
+        // Agent Demographics & Credibility
+        {"age_weight", &Configuration::age_weight},
+        {"edu_weight", &Configuration::edu_weight},
+        {"age_optimal", &Configuration::age_optimal, false},
+        {"age_spread", &Configuration::age_spread, false},
+        {"credibility_rejection_weight",
+         &Configuration::credibility_rejection_weight, false},
+
+        // Social Network
+        {"max_connections", &Configuration::max_connections},
+        {"base_interaction_prob", &Configuration::base_interaction_prob,
+         false},
+        {"same_school_weight", &Configuration::same_school_weight},
+        {"same_religious_weight", &Configuration::same_religious_weight},
+        {"same_town_weight", &Configuration::same_town_weight},
+        {"age_group_weight", &Configuration::age_group_weight, false},
+        {"ethnicity_weight", &Configuration::ethnicity_weight, false},
+        {"religious_participation_prob",
+         &Configuration::religious_participation_prob},
+        {"same_workplace_weight", &Configuration::same_workplace_weight},
+        {"homophily_strength", &Configuration::homophily_strength},
+
+        // SEDPNR Transitions
+        {"prob_s_to_e", &Configuration::prob_s_to_e},
+        {"prob_e_to_d", &Configuration::prob_e_to_d},
+        {"prob_d_to_p", &Configuration::prob_d_to_p},
+        {"prob_d_to_n", &Configuration::prob_d_to_n},
+        {"prob_d_to_r", &Configuration::prob_d_to_r},
+        {"prob_p_to_n", &Configuration::prob_p_to_n},
+        {"prob_p_to_r", &Configuration::prob_p_to_r},
+        {"prob_n_to_r", &Configuration::prob_n_to_r},
+
+        // Claim Mechanics
+        {"misinfo_multiplier", &Configuration::misinfo_multiplier},
+        {"truth_threshold", &Configuration::truth_threshold},
+        {"misinfo_threshold", &Configuration::misinfo_threshold},
+
+        // Simulation Settings
+        {"output_interval", &Configuration::output_interval},
+        {"full_spatial_snapshot", &Configuration::full_spatial_snapshot},
+        {"local_counts", &Configuration::local_counts},
+        {"demographic_counts", &Configuration::demographic_counts},
+        {"spatial_index", &Configuration::spatial_index},
+        {"arrow_output", &Configuration::arrow_output},
+        {"spatial_panel_size", &Configuration::spatial_panel_size},
+        {"spatial_panel_strata", &Configuration::spatial_panel_strata},
+        {"spatial_reservoir_size", &Configuration::spatial_reservoir_size},
+        {"spatial_interval", &Configuration::spatial_interval},
+        {"local_counts_interval", &Configuration::local_counts_interval},
+        {"demographic_counts_interval",
+         &Configuration::demographic_counts_interval},
+        {"live_view", &Configuration::live_view},
+
+        // Hub Exposure
+        {"hub_exposure", &Configuration::hub_exposure},
+        {"hub_exposure_weight", &Configuration::hub_exposure_weight},
+
+        // Engine
+        {"sparse_engine", &Configuration::sparse_engine},
+        {"counter_rng", &Configuration::counter_rng},
+        {"reorder_agents", &Configuration::reorder_agents},
+        {"partitions", &Configuration::partitions},
+        {"news_cycle_claims", &Configuration::news_cycle_claims},
+        {"news_cycle_seeds", &Configuration::news_cycle_seeds},
+
+        // Connection Pruning
+        {"enable_connection_pruning",
+         &Configuration::enable_connection_pruning},
+        {"connection_patience", &Configuration::connection_patience},
+
+        // Memory accounting / Profiling
+        {"memory_sample_interval", &Configuration::memory_sample_interval},
+        {"profile_step_breakdown", &Configuration::profile_step_breakdown},
+    };
+    return table;
+  }
+
   // Load from .cfg file
   void load(const std::string &filename) {
     std::ifstream file(filename);
@@ -81,23 +239,65 @@ struct Configuration {
       return;
 
     std::string line;
+    int lineNo = 0;
+    int problems = 0;
     while (std::getline(file, line)) {
+      lineNo++;
       size_t comment = line.find('#');
       if (comment != std::string::npos)
         line = line.substr(0, comment);
-      if (line.empty())
+      if (trim(line).empty())
         continue;
 
       std::stringstream ss(line);
       std::string key, val;
-      if (std::getline(ss, key, '=') && std::getline(ss, val)) {
+      std::string error;
+      if (!std::getline(ss, key, '=') || !std::getline(ss, val)) {
+        error = "expected key=value";
+      } else {
         key = trim(key);
         val = trim(val);
-        updateParam(key, val);
+        updateParam(key, val, error);
+      }
+
+      if (!error.empty()) {
+        std::cerr << "Warning: " << filename << ":" << lineNo << ": " << error
+                  << std::endl;
+        problems++;
       }
     }
-    std::cout << "Successfully loaded configuration from " << filename
-              << std::endl;
+    std::cout << "Successfully loaded configuration from " << filename;
+    if (problems > 0)
+      std::cout << " (" << problems << " line(s) ignored)";
+    std::cout << std::endl;
+  }
+
+  // Set one parameter by name; returns false (and explains why in error)
+  // for unknown keys and values that do not parse as the field's type
+  bool updateParam(const std::string &key, const std::string &val,
+                   std::string &error) {
+    for (const auto &spec : schema()) {
+      if (key != spec.key)
+        continue;
+
+      bool ok = std::visit(
+          [&](auto member) {
+            auto value = this->*member;
+            if (!parseValue(val, value))
+              return false;
+            if (spec.applied)
+              this->*member = value;
+            return true;
+          },
+          spec.field);
+      if (!ok) {
+        error = "invalid " + typeName(spec.field) + " value '" + val +
+                "' for '" + key + "'";
+      }
+      return ok;
+    }
+    error = "unknown parameter '" + key + "'";
+    return false;
   }
 
 private:
@@ -109,77 +309,69 @@ private:
     return s.substr(first, (last - first + 1));
   }
 
-  void updateParam(const std::string &key, const std::string &val) {
+  static std::string typeName(const Field &field) {
+    switch (field.index()) {
+    case 0:
+      return "integer";
+    case 1:
+      return "unsigned integer";
+    case 2:
+      return "number";
+    default:
+      return "boolean";
+    }
+  }
+
+  // Strict parsers: the whole value must be consumed
+  static bool parseValue(const std::string &val, int &out) {
     try {
-      if (key == "population")
-        population = std::stoi(val);
-      else if (key == "timesteps")
-        timesteps = std::stoi(val);
-      else if (key == "age_weight")
-        age_weight = std::stod(val);
-      else if (key == "edu_weight")
-        edu_weight = std::stod(val);
-      else if (key == "num_towns")
-        num_towns = std::stoi(val);
-      else if (key == "schools_per_town")
-        schools_per_town = std::stoi(val);
-      else if (key == "religious_per_town")
-        religious_per_town = std::stoi(val);
-      else if (key == "school_capacity")
-        school_capacity = std::stoi(val);
-      else if (key == "religious_capacity")
-        religious_capacity = std::stoi(val);
-      else if (key == "same_school_weight")
-        same_school_weight = std::stod(val);
-      else if (key == "same_religious_weight")
-        same_religious_weight = std::stod(val);
-      else if (key == "same_town_weight")
-        same_town_weight = std::stod(val);
-      else if (key == "max_connections")
-        max_connections = std::stoi(val);
-      else if (key == "misinfo_multiplier")
-        misinfo_multiplier = std::stod(val);
-      else if (key == "truth_threshold")
-        truth_threshold = std::stod(val);
-      else if (key == "misinfo_threshold")
-        misinfo_threshold = std::stod(val);
-      else if (key == "prob_s_to_e")
-        prob_s_to_e = std::stod(val);
-      else if (key == "prob_e_to_d")
-        prob_e_to_d = std::stod(val);
-      else if (key == "prob_d_to_p")
-        prob_d_to_p = std::stod(val);
-      else if (key == "prob_d_to_n")
-        prob_d_to_n = std::stod(val);
-      else if (key == "prob_d_to_r")
-        prob_d_to_r = std::stod(val);
-      else if (key == "prob_p_to_n")
-        prob_p_to_n = std::stod(val);
-      else if (key == "prob_p_to_r")
-        prob_p_to_r = std::stod(val);
-      else if (key == "prob_n_to_r")
-        prob_n_to_r = std::stod(val);
-      else if (key == "seed")
-        seed = (unsigned int)std::stoul(val);
-      else if (key == "output_interval")
-        output_interval = std::stoi(val);
-      else if (key == "religious_participation_prob")
-        religious_participation_prob = std::stod(val);
-      else if (key == "workplaces_per_town")
-        workplaces_per_town = std::stoi(val);
-      else if (key == "workplace_capacity")
-        workplace_capacity = std::stoi(val);
-      else if (key == "same_workplace_weight")
-        same_workplace_weight = std::stod(val);
-      else if (key == "homophily_strength")
-        homophily_strength = std::stod(val);
-      else if (key == "full_spatial_snapshot")
-        full_spatial_snapshot = (val == "true" || val == "1");
-      else if (key == "enable_connection_pruning")
-        enable_connection_pruning = (val == "true" || val == "1");
-      else if (key == "connection_patience")
-        connection_patience = std::stoi(val);
+      size_t pos = 0;
+      int v = std::stoi(val, &pos);
+      if (pos != val.size())
+        return false;
+      out = v;
+      return true;
     } catch (...) {
+      return false;
+    }
+  }
+
+  static bool parseValue(const std::string &val, unsigned int &out) {
+    try {
+      size_t pos = 0;
+      unsigned long v = std::stoul(val, &pos);
+      if (pos != val.size() || val[0] == '-' ||
+          v > std::numeric_limits<unsigned int>::max())
+        return false;
+      out = static_cast<unsigned int>(v);
+      return true;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  static bool parseValue(const std::string &val, double &out) {
+    try {
+      size_t pos = 0;
+      double v = std::stod(val, &pos);
+      if (pos != val.size())
+        return false;
+      out = v;
+      return true;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  static bool parseValue(const std::string &val, bool &out) {
+    if (val == "true" || val == "1") {
+      out = true;
+      return true;
+    }
+    if (val == "false" || val == "0") {
+      out = false;
+      return true;
     }
+    return false;
   }
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// ============================================================================
+// COUNTER-BASED RANDOM STREAMS
+// With counter_rng=true every (step, claim, agent) evaluation draws from its
+// own short stream keyed by those coordinates instead of the single shared
+// mt19937. Draws then no longer depend on the order in which agents are
+// processed, so a run split across processes reproduces a single-process
+// run exactly. Agents are keyed by generation-order ID, so reorder_agents
+// does not change the draws either. SplitMix64 (Steele, Lea & Flood 2014)
+// is used both to mix the key and to generate the stream.
+// ============================================================================
+
+class CounterRng {
+public:
+  using result_type = uint64_t;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  // Start the stream for one evaluation
+  void seed(uint64_t runSeed, int64_t step, int64_t claim, int64_t agent) {
+    uint64_t key = mix(runSeed ^ 0x9e3779b97f4a7c15ULL);
+    key = mix(key ^ static_cast<uint64_t>(step));
+    key = mix(key ^ static_cast<uint64_t>(claim));
+    state = mix(key ^ static_cast<uint64_t>(agent));
+  }
+
+  result_type operator()() {
+    state += 0x9e3779b97f4a7c15ULL;
+    return mix(state);
+  }
+
+private:
+  static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  uint64_t state = 0;
+};
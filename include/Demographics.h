@@ -44,6 +44,29 @@ enum class ReligiousDenomination {
   NUM_DENOMINATIONS
 };
 
+inline const char *denominationToString(ReligiousDenomination denom) {
+  switch (denom) {
+  case ReligiousDenomination::CATHOLIC:
+    return "Catholic";
+  case ReligiousDenomination::EVANGELICAL:
+    return "Evangelical";
+  case ReligiousDenomination::MAINLINE:
+    return "Mainline";
+  case ReligiousDenomination::LDS:
+    return "LDS";
+  case ReligiousDenomination::JEWISH:
+    return "Jewish";
+  case ReligiousDenomination::MUSLIM:
+    return "Muslim";
+  case ReligiousDenomination::BUDDHIST:
+    return "Buddhist";
+  case ReligiousDenomination::HINDU:
+    return "Hindu";
+  default:
+    return "Other";
+  }
+}
+
 // ============================================================================
 // DEMOGRAPHIC PROBABILITIES (Phoenix, AZ Estimates ~2024)
 // ============================================================================
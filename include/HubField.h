@@ -0,0 +1,145 @@
+#pragma once
+
+#include "City.h"
+#include "Demographics.h"
+#include "SEDPNR.h"
+#include "SimParams.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// ============================================================================
+// HUB MEAN-FIELD EXPOSURE
+// Optional exposure term (hub_exposure=true) from the agent's school,
+// religious site and workplace, independent of which pairwise links the
+// network happened to sample. Once per claim per step, propagators are
+// counted per location by ethnicity, denomination, age group and education
+// level. A susceptible agent then reads its 1-3 hubs in O(1):
+//
+//   hub exposure = sum over hubs of typeWeight * S / (members - 1)
+//   S = P + bEth * P[eth] + bRel * P[denom] + bAge * P[age group]
+//         + bEdu * P[edu - 1 .. edu + 1]
+//
+// The bonuses b are SimParams::hubBonus, so S is the linear counterpart of
+// summing similarityWeight over the hub's propagators: exact for
+// homophily_strength = 1 and for single-trait matches, except that "age
+// within 10 years" is approximated by "same age group".
+// ============================================================================
+
+class HubField {
+public:
+  static constexpr int NUM_ETHNICITIES =
+      static_cast<int>(EthnicGroup::NUM_GROUPS);
+  static constexpr int NUM_DENOMS =
+      static_cast<int>(ReligiousDenomination::NUM_DENOMINATIONS);
+  static constexpr int NUM_AGE_GROUPS = static_cast<int>(AgeGroup::NUM_GROUPS);
+  static constexpr int NUM_EDUCATION = 6; // Agent::educationLevel is 0-5
+
+  // Per-location slot layout: [total | ethnicity | denomination | age | edu]
+  static constexpr int ETH_OFFSET = 1;
+  static constexpr int DENOM_OFFSET = ETH_OFFSET + NUM_ETHNICITIES;
+  static constexpr int AGE_OFFSET = DENOM_OFFSET + NUM_DENOMS;
+  static constexpr int EDU_OFFSET = AGE_OFFSET + NUM_AGE_GROUPS;
+  static constexpr int STRIDE = EDU_OFFSET + NUM_EDUCATION;
+
+  // Size the aggregates once per run; accumulate() and clear() then never
+  // allocate
+  void resize(size_t numLocations, size_t population) {
+    counts.assign(numLocations * STRIDE, 0);
+    propagators.clear();
+    propagators.reserve(population);
+  }
+
+  bool empty() const { return counts.empty(); }
+
+  // Count the propagators of a claim at each of their locations
+  void accumulate(const City &city, int claimId) {
+    propagators.clear();
+    for (const auto &agent : city.agents) {
+      if (agent.getState(claimId) != SEDPNRState::PROPAGATING)
+        continue;
+      propagators.push_back(agent.id);
+      for (int loc : {agent.schoolLocationId, agent.religiousLocationId,
+                      agent.workplaceLocationId}) {
+        if (loc >= 0)
+          addTo(city, agent, loc, 1);
+      }
+    }
+  }
+
+  // Zero the slots touched by the last accumulate(): O(propagators)
+  void clear(const City &city) {
+    for (int id : propagators) {
+      const Agent &agent = city.agents[id];
+      for (int loc : {agent.schoolLocationId, agent.religiousLocationId,
+                      agent.workplaceLocationId}) {
+        if (loc >= 0)
+          addTo(city, agent, loc, -1);
+      }
+    }
+    propagators.clear();
+  }
+
+  // Mean-field exposure of an agent through its hubs
+  double exposure(const City &city, const Agent &agent,
+                  const SimParams &p) const {
+    double total = 0.0;
+    total += hubTerm(city, agent, agent.schoolLocationId, p.hubTypeWeight[0],
+                     p);
+    total += hubTerm(city, agent, agent.religiousLocationId,
+                     p.hubTypeWeight[1], p);
+    total += hubTerm(city, agent, agent.workplaceLocationId,
+                     p.hubTypeWeight[2], p);
+    return total;
+  }
+
+  size_t payloadBytes() const {
+    return (counts.size() + propagators.size()) * sizeof(int);
+  }
+  const std::vector<int> &aggregates() const { return counts; }
+  const std::vector<int> &propagatorList() const { return propagators; }
+
+private:
+  void addTo(const City &city, const Agent &agent, int loc, int delta) {
+    int *slot = &counts[static_cast<size_t>(loc) * STRIDE];
+    slot[0] += delta;
+    slot[ETH_OFFSET + static_cast<int>(agent.ethnicity)] += delta;
+    slot[DENOM_OFFSET + static_cast<int>(agent.denomination)] += delta;
+    slot[AGE_OFFSET + static_cast<int>(city.ageGroups[agent.id])] += delta;
+    slot[EDU_OFFSET + agent.educationLevel] += delta;
+  }
+
+  double hubTerm(const City &city, const Agent &agent, int loc,
+                 double typeWeight, const SimParams &p) const {
+    if (loc < 0)
+      return 0.0;
+    const int *slot = &counts[static_cast<size_t>(loc) * STRIDE];
+    if (slot[0] == 0)
+      return 0.0;
+
+    // Everyone else at the hub (the agent itself is not a propagator)
+    int others = static_cast<int>(city.locations.membersOf(loc).size()) - 1;
+    if (others <= 0)
+      return 0.0;
+
+    // Education within one level
+    int eduLo = std::max(0, agent.educationLevel - 1);
+    int eduHi = std::min(NUM_EDUCATION - 1, agent.educationLevel + 1);
+    int nearEdu = 0;
+    for (int e = eduLo; e <= eduHi; ++e)
+      nearEdu += slot[EDU_OFFSET + e];
+
+    double weighted =
+        slot[0] +
+        p.hubBonus[0] * slot[ETH_OFFSET + static_cast<int>(agent.ethnicity)] +
+        p.hubBonus[1] *
+            slot[DENOM_OFFSET + static_cast<int>(agent.denomination)] +
+        p.hubBonus[2] *
+            slot[AGE_OFFSET + static_cast<int>(city.ageGroups[agent.id])] +
+        p.hubBonus[3] * nearEdu;
+    return typeWeight * weighted / others;
+  }
+
+  std::vector<int> counts;      // numLocations * STRIDE propagator counts
+  std::vector<int> propagators; // Agents counted by the last accumulate()
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// LIVE VIEW
+// With live_view=true the simulation publishes every step's states into a
+// POSIX shared-memory ring (LIVE_VIEW_NAME) that `visualizer --live`
+// attaches to. The region holds a header, one row per claim, one static
+// row per agent (indexed by generation-order ID, as in spatial_data.csv)
+// and LIVE_VIEW_SLOTS step slots of one int8 state per claim and agent.
+// Each slot is guarded by a sequence lock: the writer makes the sequence
+// odd, copies the states and makes it even again, never waiting for a
+// reader. A reader keeps its copy only if the sequence was even and
+// unchanged across the copy, so a slow or detached viewer costs the run
+// nothing beyond one copy per step.
+// ============================================================================
+
+constexpr const char *LIVE_VIEW_NAME = "/sedpnr_live";
+constexpr uint32_t LIVE_VIEW_MAGIC = 0x4C564553; // "SEVL"
+constexpr uint32_t LIVE_VIEW_SLOTS = 4;
+
+struct LiveHeader {
+  std::atomic<uint32_t> magic; // Set once the region is filled
+  uint32_t agents;
+  uint32_t claims;
+  uint32_t slots;
+  uint64_t slotBytes;
+  std::atomic<uint64_t> published; // Steps published so far
+};
+
+struct LiveClaim {
+  int32_t claimId;
+  int32_t isMisinfo;
+};
+
+// Static fields of one agent
+struct LiveAgent {
+  int32_t townId;
+  int32_t schoolId;
+  int32_t religiousId;
+  int32_t workplaceId;
+  int32_t ethnicity;
+  int32_t denomination;
+};
+
+// Step n (1-based) is in slot (n - 1) % slots; its sequence is 2n - 1
+// while being written and 2n once complete
+struct LiveSlot {
+  std::atomic<uint64_t> seq;
+  int32_t time;
+  int32_t reserved;
+  // Followed by int8 states[claims * agents], claim-major
+};
+
+namespace live_detail {
+
+inline size_t align64(size_t n) { return (n + 63) & ~size_t(63); }
+
+struct Layout {
+  size_t claimsOffset, agentsOffset, slotsOffset, slotBytes, total;
+
+  Layout(size_t agents, size_t claims, size_t slots) {
+    claimsOffset = align64(sizeof(LiveHeader));
+    agentsOffset = align64(claimsOffset + claims * sizeof(LiveClaim));
+    slotsOffset = align64(agentsOffset + agents * sizeof(LiveAgent));
+    slotBytes = align64(sizeof(LiveSlot) + claims * agents);
+    total = slotsOffset + slots * slotBytes;
+  }
+};
+
+} // namespace live_detail
+
+// Simulation side: owns and unlinks the shared-memory object
+class LivePublisher {
+public:
+  ~LivePublisher() { close(); }
+
+  bool isOpen() const { return base != nullptr; }
+  size_t claimCount() const { return isOpen() ? header()->claims : 0; }
+
+  // Create (or replace) the region for the given claims and agents
+  bool open(const std::vector<LiveClaim> &claims,
+            const std::vector<LiveAgent> &agents) {
+    close();
+    live_detail::Layout layout(agents.size(), claims.size(), LIVE_VIEW_SLOTS);
+    shm_unlink(LIVE_VIEW_NAME);
+    int fd = shm_open(LIVE_VIEW_NAME, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+      return false;
+    void *p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(layout.total)) == 0)
+      p = mmap(nullptr, layout.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+               0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      shm_unlink(LIVE_VIEW_NAME);
+      return false;
+    }
+    base = static_cast<char *>(p);
+    size = layout.total;
+    slotsOffset = layout.slotsOffset;
+    agentCount = agents.size();
+
+    // The header goes last so a reader never sees a half-filled region
+    std::memcpy(base + layout.claimsOffset, claims.data(),
+                claims.size() * sizeof(LiveClaim));
+    std::memcpy(base + layout.agentsOffset, agents.data(),
+                agents.size() * sizeof(LiveAgent));
+    LiveHeader *h = new (base) LiveHeader{};
+    h->agents = static_cast<uint32_t>(agents.size());
+    h->claims = static_cast<uint32_t>(claims.size());
+    h->slots = LIVE_VIEW_SLOTS;
+    h->slotBytes = layout.slotBytes;
+    h->published.store(0, std::memory_order_relaxed);
+    h->magic.store(LIVE_VIEW_MAGIC, std::memory_order_release);
+    return true;
+  }
+
+  void close() {
+    if (!base)
+      return;
+    munmap(base, size);
+    shm_unlink(LIVE_VIEW_NAME);
+    base = nullptr;
+  }
+
+  // States of the next step, claim-major [claim * agents + agent]; fill
+  // them and call commitStep()
+  int8_t *beginStep(int time) {
+    step = header()->published.load(std::memory_order_relaxed) + 1;
+    current = slot(step);
+    current->seq.store(2 * step - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    current->time = time;
+    return reinterpret_cast<int8_t *>(current + 1);
+  }
+
+  void commitStep() {
+    current->seq.store(2 * step, std::memory_order_release);
+    header()->published.store(step, std::memory_order_release);
+  }
+
+  size_t agents() const { return agentCount; }
+
+private:
+  LiveHeader *header() const { return reinterpret_cast<LiveHeader *>(base); }
+  LiveSlot *slot(uint64_t n) const {
+    return reinterpret_cast<LiveSlot *>(base + slotsOffset +
+                                        ((n - 1) % LIVE_VIEW_SLOTS) *
+                                            header()->slotBytes);
+  }
+
+  char *base = nullptr;
+  size_t size = 0;
+  size_t slotsOffset = 0;
+  size_t agentCount = 0;
+  LiveSlot *current = nullptr;
+  uint64_t step = 0;
+};
+
+// Viewer side: read-only mapping of a published region
+class LiveSubscriber {
+public:
+  ~LiveSubscriber() {
+    if (base)
+      munmap(const_cast<char *>(base), size);
+  }
+
+  // Map the region if the simulation has created it
+  bool attach() {
+    if (base)
+      return true;
+    int fd = shm_open(LIVE_VIEW_NAME, O_RDONLY, 0);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(LiveHeader))
+      p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+               MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      return false;
+    const LiveHeader *h = static_cast<const LiveHeader *>(p);
+    if (h->magic.load(std::memory_order_acquire) != LIVE_VIEW_MAGIC) {
+      munmap(p, static_cast<size_t>(st.st_size));
+      return false; // Still being set up
+    }
+    base = static_cast<const char *>(p);
+    size = static_cast<size_t>(st.st_size);
+    layout = live_detail::Layout(h->agents, h->claims, h->slots);
+    return true;
+  }
+
+  size_t agents() const { return header()->agents; }
+  size_t claims() const { return header()->claims; }
+  const LiveClaim *claimRows() const {
+    return reinterpret_cast<const LiveClaim *>(base + layout.claimsOffset);
+  }
+  const LiveAgent *agentRows() const {
+    return reinterpret_cast<const LiveAgent *>(base + layout.agentsOffset);
+  }
+
+  // Copy the newest complete step if it is newer than the last one
+  // returned. Retries when the writer laps the slot during the copy
+  bool latest(std::vector<int8_t> &states, int &time) {
+    const LiveHeader *h = header();
+    size_t bytes = claims() * agents();
+    states.resize(bytes);
+    for (int attempt = 0; attempt < 8; ++attempt) {
+      uint64_t n = h->published.load(std::memory_order_acquire);
+      if (n == 0 || n == seen)
+        return false;
+      const LiveSlot *s = reinterpret_cast<const LiveSlot *>(
+          base + layout.slotsOffset + ((n - 1) % h->slots) * h->slotBytes);
+      uint64_t before = s->seq.load(std::memory_order_acquire);
+      if (before != 2 * n)
+        continue;
+      int t = s->time;
+      std::memcpy(states.data(), s + 1, bytes);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s->seq.load(std::memory_order_relaxed) != before)
+        continue;
+      time = t;
+      seen = n;
+      return true;
+    }
+    return false;
+  }
+
+private:
+  const LiveHeader *header() const {
+    return reinterpret_cast<const LiveHeader *>(base);
+  }
+
+  const char *base = nullptr;
+  size_t size = 0;
+  live_detail::Layout layout{0, 0, 0};
+  uint64_t seen = 0;
+};
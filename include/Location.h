@@ -1,7 +1,7 @@
 #pragma once
 #include "Demographics.h"
+#include <memory_resource>
 #include <string>
-#include <vector>
 
 // ============================================================================
 // LOCATION TYPE
@@ -16,36 +16,29 @@ enum class LocationType {
 
 // ============================================================================
 // LOCATION STRUCTURE
-// Represents a physical location where agents gather
+// Represents a physical location where agents gather. Locations live in
+// City's LocationRegistry, which also owns their member lists.
 // ============================================================================
 
 struct Location {
-  int id;
+  int id; // Dense registry index
   LocationType type;
   int townId;
-  std::string name;
+  std::pmr::string name;
   int capacity;                       // Max agents that can be assigned
   ReligiousDenomination denomination; // Only for religious sites
-  std::vector<int> assignedAgents;    // Agent IDs at this location
+  int occupancy;                      // Agents assigned so far
 
   Location()
       : id(-1), type(LocationType::HOME), townId(-1), capacity(0),
-        denomination(ReligiousDenomination::NONE) {}
+        denomination(ReligiousDenomination::NONE), occupancy(0) {}
 
   Location(int locId, LocationType locType, int town,
            const std::string &locName, int cap,
-           ReligiousDenomination denom = ReligiousDenomination::NONE)
-      : id(locId), type(locType), townId(town), name(locName), capacity(cap),
-        denomination(denom) {}
-
-  // Add an agent to this location
-  bool assignAgent(int agentId) {
-    if (static_cast<int>(assignedAgents.size()) >= capacity) {
-      return false; // Location full
-    }
-    assignedAgents.push_back(agentId);
-    return true;
-  }
+           ReligiousDenomination denom = ReligiousDenomination::NONE,
+           std::pmr::memory_resource *mem = std::pmr::get_default_resource())
+      : id(locId), type(locType), townId(town), name(locName, mem),
+        capacity(cap), denomination(denom), occupancy(0) {}
 
   // Get location type as string
   std::string getTypeString() const {
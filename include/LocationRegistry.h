@@ -0,0 +1,285 @@
+#pragma once
+
+#include "Demographics.h"
+#include "Location.h"
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// ALIAS TABLE
+// Walker/Vose alias method: O(n) build, O(1) weighted sampling
+// ============================================================================
+
+class AliasTable {
+public:
+  void build(const std::vector<double> &weights) {
+    size_t n = weights.size();
+    prob.assign(n, 0.0);
+    alias.assign(n, 0);
+    if (n == 0)
+      return;
+
+    double total = 0.0;
+    for (double w : weights)
+      total += w;
+
+    std::vector<double> scaled(n);
+    std::vector<int> small, large;
+    for (size_t i = 0; i < n; ++i) {
+      scaled[i] = total > 0.0 ? weights[i] * n / total : 1.0;
+      (scaled[i] < 1.0 ? small : large).push_back(static_cast<int>(i));
+    }
+
+    while (!small.empty() && !large.empty()) {
+      int s = small.back();
+      small.pop_back();
+      int l = large.back();
+      prob[s] = scaled[s];
+      alias[s] = l;
+      scaled[l] -= 1.0 - scaled[s];
+      if (scaled[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // Leftovers are 1.0 up to rounding
+    for (int i : large)
+      prob[i] = 1.0;
+    for (int i : small)
+      prob[i] = 1.0;
+  }
+
+  bool empty() const { return prob.empty(); }
+  size_t size() const { return prob.size(); }
+
+  // Returns an index in [0, size())
+  int sample(std::mt19937 &rng) const {
+    std::uniform_int_distribution<int> column(0,
+                                              static_cast<int>(prob.size()) - 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    int i = column(rng);
+    return coin(rng) < prob[i] ? i : alias[i];
+  }
+
+  std::vector<double> prob;
+  std::vector<int> alias;
+};
+
+// ============================================================================
+// LOCATION REGISTRY
+// All locations of the city in one dense array: Location::id is the index,
+// so location-indexed arrays are plain vectors. Members are stored as a
+// CSR list (memberOffsets/members), and each (town, type, denomination)
+// site pool offers O(1) capacity-aware sampling.
+// ============================================================================
+
+class LocationRegistry {
+public:
+  // Site pools are keyed by location type and denomination within a town
+  static constexpr int NUM_POOL_TYPES = 3; // School, Religious, Workplace
+  static constexpr int NUM_DENOMS =
+      static_cast<int>(ReligiousDenomination::NUM_DENOMINATIONS);
+
+  // Dense location storage (index == Location::id)
+  std::vector<Location> locations;
+
+  // CSR member lists: members of location i are
+  // members[memberOffsets[i] .. memberOffsets[i + 1])
+  std::vector<int> memberOffsets;
+  std::vector<int> members;
+
+  // Agents placed over capacity because every site in their pool was full
+  int overflowAssignments = 0;
+
+  struct MemberRange {
+    const int *first;
+    const int *last;
+    const int *begin() const { return first; }
+    const int *end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+  };
+
+  void clear(int numTowns) {
+    locations.clear();
+    memberOffsets.clear();
+    members.clear();
+    openPos.clear();
+    overflowAssignments = 0;
+    pools.assign(static_cast<size_t>(numTowns) * NUM_POOL_TYPES * NUM_DENOMS,
+                 SitePool());
+  }
+
+  // Register a location; returns its dense ID
+  int add(LocationType type, int townId, const std::string &name, int capacity,
+          ReligiousDenomination denom, std::pmr::memory_resource *mem) {
+    int id = static_cast<int>(locations.size());
+    locations.emplace_back(id, type, townId, name, capacity, denom, mem);
+
+    SitePool &pool = pools[poolIndex(townId, type, denom)];
+    pool.sites.push_back(id);
+    openPos.push_back(-1);
+    if (capacity > 0) {
+      openPos[id] = static_cast<int>(pool.open.size());
+      pool.open.push_back(id);
+    }
+    return id;
+  }
+
+  // Build alias tables (weighted by capacity) once all sites are added
+  void finalizeSites() {
+    for (auto &pool : pools) {
+      std::vector<double> weights;
+      weights.reserve(pool.sites.size());
+      for (int id : pool.sites)
+        weights.push_back(static_cast<double>(locations[id].capacity));
+      pool.sampler.build(weights);
+    }
+  }
+
+  Location &get(int id) { return locations[id]; }
+  const Location &get(int id) const { return locations[id]; }
+  size_t size() const { return locations.size(); }
+
+  // ========================================================================
+  // CAPACITY-AWARE ASSIGNMENT
+  // ========================================================================
+
+  // Assign an agent to a random site of (town, type, denomination), drawn
+  // in proportion to capacity. Falls back to a uniform draw among sites
+  // with free capacity, and only overfills when the whole pool is full.
+  // Returns -1 only when the town has no such site at all.
+  int assignRandom(std::mt19937 &rng, int townId, LocationType type,
+                   ReligiousDenomination denom = ReligiousDenomination::NONE) {
+    SitePool &pool = pools[poolIndex(townId, type, denom)];
+    if (pool.sites.empty())
+      return -1;
+
+    int id = pool.sites[pool.sampler.sample(rng)];
+    if (!hasRoom(id))
+      id = pickOpen(pool, rng, id);
+    occupy(pool, id);
+    return id;
+  }
+
+  // Assign to a preferred site, or to any open site of its pool if full
+  int assignPreferred(std::mt19937 &rng, int preferredId) {
+    const Location &loc = locations[preferredId];
+    SitePool &pool = pools[poolIndex(loc.townId, loc.type, loc.denomination)];
+    int id = hasRoom(preferredId) ? preferredId
+                                  : pickOpen(pool, rng, preferredId);
+    occupy(pool, id);
+    return id;
+  }
+
+  // Sites of (town, type, denomination), in registration order
+  const std::vector<int> &sites(int townId, LocationType type,
+                                ReligiousDenomination denom =
+                                    ReligiousDenomination::NONE) const {
+    return pools[poolIndex(townId, type, denom)].sites;
+  }
+
+  // ========================================================================
+  // MEMBER LISTS
+  // ========================================================================
+
+  // Build the CSR member lists from the agents' location fields (agents in
+  // ascending ID order within each location)
+  template <typename AgentVec> void buildMembers(const AgentVec &agents) {
+    size_t n = locations.size();
+    memberOffsets.assign(n + 1, 0);
+    for (const auto &agent : agents) {
+      for (int loc : {agent.schoolLocationId, agent.religiousLocationId,
+                      agent.workplaceLocationId}) {
+        if (loc >= 0)
+          memberOffsets[loc + 1]++;
+      }
+    }
+    for (size_t i = 0; i < n; ++i)
+      memberOffsets[i + 1] += memberOffsets[i];
+
+    members.assign(memberOffsets[n], -1);
+    std::vector<int> cursor(memberOffsets.begin(), memberOffsets.end() - 1);
+    for (const auto &agent : agents) {
+      for (int loc : {agent.schoolLocationId, agent.religiousLocationId,
+                      agent.workplaceLocationId}) {
+        if (loc >= 0)
+          members[cursor[loc]++] = agent.id;
+      }
+    }
+  }
+
+  MemberRange membersOf(int locId) const {
+    const int *base = members.data();
+    return {base + memberOffsets[locId], base + memberOffsets[locId + 1]};
+  }
+
+  // Bytes held by the site pools (for memory accounting)
+  size_t poolBytes() const {
+    size_t bytes = openPos.capacity() * sizeof(int);
+    for (const auto &pool : pools) {
+      bytes += (pool.sites.capacity() + pool.open.capacity() +
+                pool.sampler.alias.capacity()) *
+                   sizeof(int) +
+               pool.sampler.prob.capacity() * sizeof(double);
+    }
+    return bytes + pools.capacity() * sizeof(SitePool);
+  }
+
+private:
+  struct SitePool {
+    std::vector<int> sites; // Every site in the pool
+    std::vector<int> open;  // Sites with free capacity (unordered)
+    AliasTable sampler;     // Over sites, weighted by capacity
+  };
+
+  static int poolType(LocationType type) {
+    switch (type) {
+    case LocationType::SCHOOL:
+      return 0;
+    case LocationType::RELIGIOUS_ESTABLISHMENT:
+      return 1;
+    default:
+      return 2;
+    }
+  }
+
+  size_t poolIndex(int townId, LocationType type,
+                   ReligiousDenomination denom) const {
+    return (static_cast<size_t>(townId) * NUM_POOL_TYPES + poolType(type)) *
+               NUM_DENOMS +
+           static_cast<int>(denom);
+  }
+
+  bool hasRoom(int id) const {
+    return locations[id].occupancy < locations[id].capacity;
+  }
+
+  // Uniform draw among open sites; keeps fallback when the pool is full
+  int pickOpen(SitePool &pool, std::mt19937 &rng, int fallback) {
+    if (pool.open.empty()) {
+      overflowAssignments++;
+      return fallback;
+    }
+    std::uniform_int_distribution<size_t> dist(0, pool.open.size() - 1);
+    return pool.open[dist(rng)];
+  }
+
+  void occupy(SitePool &pool, int id) {
+    Location &loc = locations[id];
+    loc.occupancy++;
+    if (loc.occupancy == loc.capacity && openPos[id] >= 0) {
+      // Swap-remove from the open list
+      int pos = openPos[id];
+      int last = pool.open.back();
+      pool.open[pos] = last;
+      openPos[last] = pos;
+      pool.open.pop_back();
+      openPos[id] = -1;
+    }
+  }
+
+  std::vector<SitePool> pools;
+  std::vector<int> openPos; // Index in its pool's open list, or -1
+};
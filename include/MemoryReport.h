@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// ============================================================================
+// MEMORY ACCOUNTING
+// Estimates live heap bytes per simulation structure and tracks the peak
+// seen across samples. Estimates assume a libstdc++/glibc-style layout:
+// every heap block carries an 8-byte header and is rounded up to 16 bytes
+// (32 minimum), and std::map nodes carry a 32-byte red-black tree header.
+// Containers using std::pmr allocators are charged RunArena pool block
+// sizes instead; the arena's own unused space is reported separately.
+// ============================================================================
+
+namespace memsize {
+
+constexpr size_t MALLOC_HEADER = 8;
+constexpr size_t MALLOC_ALIGN = 16;
+constexpr size_t MALLOC_MIN_CHUNK = 32;
+constexpr size_t POOL_ALIGN = 8;      // Pool blocks carry no header
+constexpr size_t RB_NODE_HEADER = 32; // color + parent/left/right pointers
+constexpr size_t SSO_CAPACITY = 15;   // std::string inline buffer
+
+// Bytes actually consumed by one malloc(n)
+inline size_t chunk(size_t n) {
+  if (n == 0)
+    return 0;
+  size_t s = (n + MALLOC_HEADER + MALLOC_ALIGN - 1) & ~(MALLOC_ALIGN - 1);
+  return std::max(s, MALLOC_MIN_CHUNK);
+}
+
+// Bytes consumed by one allocation of n through a given allocator type:
+// polymorphic allocators draw from a RunArena pool, others from malloc
+template <typename Alloc> size_t block(size_t n) {
+  using T = typename std::allocator_traits<Alloc>::value_type;
+  if (std::is_same<Alloc, std::pmr::polymorphic_allocator<T>>::value)
+    return (n + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1);
+  return chunk(n);
+}
+
+template <typename T, typename A> size_t payload(const std::vector<T, A> &v) {
+  return v.size() * sizeof(T);
+}
+
+template <typename T, typename A> size_t heap(const std::vector<T, A> &v) {
+  return block<A>(v.capacity() * sizeof(T));
+}
+
+template <typename K, typename V, typename C, typename A>
+size_t payload(const std::map<K, V, C, A> &m) {
+  return m.size() * sizeof(typename std::map<K, V, C, A>::value_type);
+}
+
+template <typename K, typename V, typename C, typename A>
+size_t heap(const std::map<K, V, C, A> &m) {
+  return m.size() *
+         block<A>(RB_NODE_HEADER +
+                  sizeof(typename std::map<K, V, C, A>::value_type));
+}
+
+// Strings that fit the inline buffer own no heap memory
+template <typename A>
+size_t payload(const std::basic_string<char, std::char_traits<char>, A> &s) {
+  return s.capacity() > SSO_CAPACITY ? s.size() + 1 : 0;
+}
+
+template <typename A>
+size_t heap(const std::basic_string<char, std::char_traits<char>, A> &s) {
+  return s.capacity() > SSO_CAPACITY ? block<A>(s.capacity() + 1) : 0;
+}
+
+} // namespace memsize
+
+// One accounted structure: payload is the useful data, live is payload
+// plus unused capacity and allocator overhead
+struct MemoryEntry {
+  std::string name;
+  size_t elements = 0;
+  size_t payload = 0;
+  size_t live = 0;
+  size_t peak = 0;
+
+  size_t overhead() const { return live > payload ? live - payload : 0; }
+};
+
+class MemoryReport {
+public:
+  // Start a new sample; entries keep their peaks across samples
+  void beginSample() {
+    for (auto &e : entries) {
+      e.elements = 0;
+      e.payload = 0;
+      e.live = 0;
+    }
+  }
+
+  // Accumulate into an entry (several calls per sample are summed)
+  void add(const char *name, size_t elements, size_t payload, size_t live) {
+    MemoryEntry &e = entry(name);
+    e.elements += elements;
+    e.payload += payload;
+    e.live += live;
+  }
+
+  // Fold the current sample into the peaks
+  void endSample() {
+    for (auto &e : entries)
+      e.peak = std::max(e.peak, e.live);
+  }
+
+  const MemoryEntry *find(const std::string &name) const {
+    for (const auto &e : entries) {
+      if (e.name == name)
+        return &e;
+    }
+    return nullptr;
+  }
+
+  const std::vector<MemoryEntry> &getEntries() const { return entries; }
+
+  size_t totalLive() const {
+    size_t total = 0;
+    for (const auto &e : entries)
+      total += e.live;
+    return total;
+  }
+
+  size_t totalPeak() const {
+    size_t total = 0;
+    for (const auto &e : entries)
+      total += e.peak;
+    return total;
+  }
+
+  void print(const std::string &title, std::ostream &out = std::cout) const {
+    out << "\n=== Memory Report: " << title << " ===" << std::endl;
+    out << std::left << std::setw(30) << "Structure" << std::right
+        << std::setw(12) << "Elements" << std::setw(12) << "Payload"
+        << std::setw(12) << "Overhead" << std::setw(12) << "Live"
+        << std::setw(12) << "Peak" << std::endl;
+    out << std::string(90, '-') << std::endl;
+    for (const auto &e : entries) {
+      out << std::left << std::setw(30) << e.name << std::right
+          << std::setw(12) << e.elements << std::setw(12)
+          << formatBytes(e.payload) << std::setw(12)
+          << formatBytes(e.overhead()) << std::setw(12) << formatBytes(e.live)
+          << std::setw(12) << formatBytes(e.peak) << std::endl;
+    }
+    out << std::string(90, '-') << std::endl;
+    out << std::left << std::setw(30) << "Total (accounted)" << std::right
+        << std::setw(48) << formatBytes(totalLive()) << std::setw(12)
+        << formatBytes(totalPeak()) << std::endl;
+
+    size_t rss = 0, hwm = 0;
+    if (readProcessMemory(rss, hwm)) {
+      out << std::left << std::setw(30) << "Process RSS / high-water"
+          << std::right << std::setw(48) << formatBytes(rss) << std::setw(12)
+          << formatBytes(hwm) << std::endl;
+    }
+  }
+
+  static std::string formatBytes(size_t bytes) {
+    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024.0 && unit < 4) {
+      value /= 1024.0;
+      unit++;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << " "
+       << units[unit];
+    return ss.str();
+  }
+
+  // Resident set size and its high-water mark (Linux only)
+  static bool readProcessMemory(size_t &rss, size_t &hwm) {
+    std::ifstream status("/proc/self/status");
+    if (!status.is_open())
+      return false;
+    std::string line;
+    bool found = false;
+    while (std::getline(status, line)) {
+      if (line.rfind("VmRSS:", 0) == 0) {
+        rss = std::stoul(line.substr(6)) * 1024;
+        found = true;
+      } else if (line.rfind("VmHWM:", 0) == 0) {
+        hwm = std::stoul(line.substr(6)) * 1024;
+      }
+    }
+    return found;
+  }
+
+private:
+  // Linear lookup: a handful of entries, and no temporary strings so that
+  // periodic samples inside step() do not allocate once entries exist
+  MemoryEntry &entry(const char *name) {
+    for (auto &e : entries) {
+      if (e.name == name)
+        return e;
+    }
+    entries.push_back(MemoryEntry());
+    entries.back().name = name;
+    return entries.back();
+  }
+
+  std::vector<MemoryEntry> entries; // In first-reported order
+};
@@ -0,0 +1,791 @@
+#pragma once
+
+#include "Simulation.h"
+#include "StateLedger.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <pthread.h>
+#include <string>
+#include <tuple>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// ============================================================================
+// TOWN-PARTITIONED RUN
+// Splits the towns across worker processes on one host (partitions=N). The
+// parent builds the city and seeds the claims, then forks; every worker
+// inherits a full replica but evaluates only the agents of its own towns.
+// After each claim's transitions a worker pushes the changed states of its
+// boundary agents (those with a neighbor in another worker's towns) into a
+// shared-memory ring per destination worker. A process-shared barrier then
+// lets every worker drain its incoming rings into its replica before the
+// next claim. The outcome is identical to a single-process run with the
+// same seed and the same restricted config: counter_rng=true, connection
+// pruning, hub_exposure and the sparse engine off. Other configs are
+// rejected (supports()), not adjusted, since a single-process run of them
+// would take a different path.
+// ============================================================================
+
+// Anonymous shared mapping, inherited by forked workers
+class SharedRegion {
+public:
+  explicit SharedRegion(size_t bytes) : size(bytes) {
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    base = (p == MAP_FAILED) ? nullptr : static_cast<char *>(p);
+  }
+  ~SharedRegion() {
+    if (base)
+      munmap(base, size);
+  }
+  SharedRegion(const SharedRegion &) = delete;
+  SharedRegion &operator=(const SharedRegion &) = delete;
+
+  bool ok() const { return base != nullptr; }
+  template <typename T> T *at(size_t offset) {
+    return reinterpret_cast<T *>(base + offset);
+  }
+
+private:
+  char *base;
+  size_t size;
+};
+
+// One boundary agent's new state for the claim being processed
+struct HaloUpdate {
+  int32_t agentId;
+  int32_t state;
+};
+
+// A worker's counts for its own agents at one record, and the flows since
+// its previous record; the parent sums them over workers
+struct WorkerRecord {
+  StateCounts counts;
+  FlowMatrix flows;
+};
+
+// Where a worker's wall time went, in seconds, for the timing report
+struct WorkerTimes {
+  double transitions = 0; // Evaluate and apply own agents, push halo
+  double exchange = 0;    // Both barriers and draining the incoming rings
+  double output = 0;      // Records, snapshot and count part files
+};
+
+// Single-producer/single-consumer ring in shared memory. Capacity covers
+// one claim phase (each boundary agent changes at most once per phase),
+// and the barrier after draining keeps phases from overlapping
+class HaloRing {
+public:
+  struct alignas(64) Header {
+    std::atomic<uint64_t> head; // Written by the producer
+    char pad[56];
+    std::atomic<uint64_t> tail; // Written by the consumer
+    uint64_t capacity;
+  };
+
+  static size_t bytes(uint64_t capacity) {
+    return sizeof(Header) + capacity * sizeof(HaloUpdate);
+  }
+
+  // Construct in place at the start of a shared block
+  static HaloRing create(void *where, uint64_t capacity) {
+    Header *h = new (where) Header;
+    h->head.store(0, std::memory_order_relaxed);
+    h->tail.store(0, std::memory_order_relaxed);
+    h->capacity = capacity;
+    return HaloRing(where);
+  }
+
+  HaloRing() = default;
+  explicit HaloRing(void *where)
+      : header(static_cast<Header *>(where)),
+        slots(reinterpret_cast<HaloUpdate *>(static_cast<Header *>(where) +
+                                             1)) {}
+
+  void push(const HaloUpdate &update) {
+    uint64_t h = header->head.load(std::memory_order_relaxed);
+    while (h - header->tail.load(std::memory_order_acquire) >=
+           header->capacity) {
+      sched_yield(); // Full: only possible if phases overlap
+    }
+    slots[h % header->capacity] = update;
+    header->head.store(h + 1, std::memory_order_release);
+  }
+
+  template <typename F> void drain(F &&apply) {
+    uint64_t t = header->tail.load(std::memory_order_relaxed);
+    uint64_t h = header->head.load(std::memory_order_acquire);
+    for (; t < h; ++t)
+      apply(slots[t % header->capacity]);
+    header->tail.store(t, std::memory_order_release);
+  }
+
+private:
+  Header *header = nullptr;
+  HaloUpdate *slots = nullptr;
+};
+
+// ============================================================================
+// PARTITION PLAN
+// Towns go to workers largest-first onto the least-loaded worker (LPT);
+// agents belong to the worker owning their home town
+// ============================================================================
+
+struct PartitionPlan {
+  static constexpr int MAX_WORKERS = 64; // One bit per worker in sendMask
+
+  int workers = 1;
+  std::vector<int> townOwner;           // Town -> worker
+  std::vector<std::vector<int>> owned;  // Worker -> agent IDs, ascending
+  std::vector<uint64_t> sendMask;       // Agent -> workers holding its halo
+  std::vector<uint64_t> ringCapacity;   // [src * workers + dst]
+
+  static PartitionPlan build(const City &city, int requested) {
+    PartitionPlan plan;
+    int numTowns = static_cast<int>(city.towns.size());
+    plan.workers = std::max(1, std::min({requested, numTowns, MAX_WORKERS}));
+    int w = plan.workers;
+
+    std::vector<size_t> townPop(numTowns, 0);
+    for (const auto &agent : city.agents)
+      townPop[agent.homeTownId]++;
+
+    std::vector<int> order(numTowns);
+    for (int t = 0; t < numTowns; ++t)
+      order[t] = t;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+      return townPop[a] > townPop[b];
+    });
+
+    std::vector<size_t> load(w, 0);
+    plan.townOwner.assign(numTowns, 0);
+    for (int town : order) {
+      int target = static_cast<int>(
+          std::min_element(load.begin(), load.end()) - load.begin());
+      plan.townOwner[town] = target;
+      load[target] += townPop[town];
+    }
+
+    plan.owned.assign(w, std::vector<int>());
+    plan.sendMask.assign(city.agents.size(), 0);
+    plan.ringCapacity.assign(static_cast<size_t>(w) * w, 0);
+    for (const auto &agent : city.agents) {
+      int src = plan.townOwner[agent.homeTownId];
+      plan.owned[src].push_back(agent.id);
+      for (int connId : agent.connections) {
+        int dst = plan.townOwner[city.agents[connId].homeTownId];
+        if (dst != src)
+          plan.sendMask[agent.id] |= uint64_t(1) << dst;
+      }
+      for (int dst = 0; dst < w; ++dst) {
+        if ((plan.sendMask[agent.id] >> dst) & 1)
+          plan.ringCapacity[static_cast<size_t>(src) * w + dst]++;
+      }
+    }
+    return plan;
+  }
+
+  size_t boundaryAgents() const {
+    size_t n = 0;
+    for (uint64_t mask : sendMask)
+      n += mask != 0;
+    return n;
+  }
+};
+
+// ============================================================================
+// PARTITIONED RUNNER
+// ============================================================================
+
+class PartitionedRun {
+public:
+  PartitionedRun(Simulation &s, int requestedWorkers)
+      : sim(s), plan(PartitionPlan::build(s.city, requestedWorkers)) {}
+
+  const PartitionPlan &getPlan() const { return plan; }
+
+  // True if a partitioned run of these parameters matches a single-process
+  // one; otherwise prints what to change. Per-agent random streams keep
+  // the outcome independent of processing order, and pruning, hub_exposure
+  // and the sparse engine depend on state outside a worker's towns
+  static bool supports(const SimParams &p) {
+    if (p.counter_rng && !p.enable_connection_pruning && !p.hub_exposure &&
+        !p.sparse_engine)
+      return true;
+    std::cerr << "Error: partitions > 1 needs counter_rng=true, "
+                 "enable_connection_pruning=false, hub_exposure=false and "
+                 "sparse_engine=false"
+              << std::endl;
+    return false;
+  }
+
+  // Run timeSteps steps across the workers; on success the simulation's
+  // state and flow histories, spatial file and clock look as after a
+  // single-process run
+  bool run(int timeSteps) {
+    if (!supports(sim.params))
+      return false;
+    int w = plan.workers;
+    size_t numClaims = sim.claims.size();
+    int start = sim.currentTime;
+    int interval = sim.params.output_interval;
+    size_t records = 0;
+    for (int t = start; t < start + timeSteps; ++t)
+      records += (t % interval == 0);
+
+    // Shared layout: barrier | rings | per-worker counts and flows
+    size_t offset = align(sizeof(pthread_barrier_t));
+    std::vector<size_t> ringOffset(static_cast<size_t>(w) * w, 0);
+    for (size_t r = 0; r < ringOffset.size(); ++r) {
+      ringOffset[r] = offset;
+      uint64_t capacity = std::max<uint64_t>(1, plan.ringCapacity[r]);
+      offset += align(HaloRing::bytes(capacity));
+    }
+    size_t countsOffset = offset;
+    offset += align(sizeof(WorkerRecord) * w * numClaims * records);
+    size_t timesOffset = offset;
+    offset += align(sizeof(WorkerTimes) * w);
+
+    SharedRegion shared(offset);
+    if (!shared.ok()) {
+      std::cerr << "Error: Could not map shared memory for partitioned run"
+                << std::endl;
+      return false;
+    }
+
+    pthread_barrier_t *barrier = shared.at<pthread_barrier_t>(0);
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(barrier, &attr, static_cast<unsigned>(w));
+    pthread_barrierattr_destroy(&attr);
+
+    std::vector<HaloRing> rings(ringOffset.size());
+    for (size_t r = 0; r < ringOffset.size(); ++r) {
+      rings[r] = HaloRing::create(shared.at<char>(ringOffset[r]),
+                                  std::max<uint64_t>(1, plan.ringCapacity[r]));
+    }
+    WorkerRecord *counts = shared.at<WorkerRecord>(countsOffset);
+    WorkerTimes *times = shared.at<WorkerTimes>(timesOffset);
+    for (int k = 0; k < w; ++k)
+      new (times + k) WorkerTimes();
+
+    std::cout << "Partitioned run: " << w << " workers, "
+              << plan.boundaryAgents() << " boundary agents" << std::endl;
+
+    // Nothing buffered may be inherited and written twice
+    std::cout.flush();
+    std::cerr.flush();
+    if (sim.spatialFile.is_open())
+      sim.spatialFile.flush();
+    sim.spatialIndex.flush();
+    if (sim.localFile.is_open())
+      sim.localFile.flush();
+    if (sim.demographicFile.is_open())
+      sim.demographicFile.flush();
+    sim.spatialArrow.flush();
+    sim.resultsArrow.flush();
+
+    Clock::time_point forked = Clock::now();
+    std::vector<pid_t> pids;
+    for (int k = 0; k < w; ++k) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        std::cerr << "Error: fork failed for worker " << k << std::endl;
+        stopWorkers(pids);
+        pthread_barrier_destroy(barrier);
+        return false;
+      }
+      if (pid == 0) {
+        runWorker(k, timeSteps, barrier, rings, counts, records, times[k]);
+        _exit(0);
+      }
+      pids.push_back(pid);
+    }
+
+    bool ok = waitWorkers(pids);
+    pthread_barrier_destroy(barrier);
+    if (!ok)
+      return false;
+    Clock::time_point joined = Clock::now();
+
+    // Sum the per-worker counts and flows into the history
+    for (size_t c = 0; c < numClaims; ++c) {
+      int claimId = sim.claims[c].claimId;
+      auto &history = sim.stateHistory[claimId];
+      auto &flows = sim.flowHistory[claimId];
+      for (size_t r = 0; r < records; ++r) {
+        StateCounts total;
+        FlowMatrix moved{};
+        for (int k = 0; k < w; ++k) {
+          const WorkerRecord &part = counts[(k * numClaims + c) * records + r];
+          total.add(part.counts);
+          addFlows(moved, part.flows);
+        }
+        history.push_back(total);
+        flows.push_back(moved);
+      }
+    }
+    for (size_t r = 0; r < records; ++r)
+      sim.writeResultsArrow(records - 1 - r);
+
+    mergeSpatialParts();
+    mergeLocalParts();
+    mergeDemographicParts();
+    sim.currentTime = start + timeSteps;
+    reportTimes(times, seconds(forked, joined), seconds(joined, Clock::now()));
+    return true;
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  static size_t align(size_t n) { return (n + 63) & ~size_t(63); }
+
+  static double seconds(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+  }
+
+  // Where the time went: the workers' phases, then the parent summing the
+  // counts and merging the part files. Exchange includes waiting at the
+  // barriers for the slowest worker, or for a CPU when workers share one
+  void reportTimes(const WorkerTimes *times, double workers,
+                   double merge) const {
+    std::cout << "Partitioned run time: workers " << workers * 1e3
+              << " ms, merge " << merge * 1e3 << " ms" << std::endl;
+    for (int k = 0; k < plan.workers; ++k) {
+      std::cout << "  worker " << k << ": transitions "
+                << times[k].transitions * 1e3 << " ms, exchange "
+                << times[k].exchange * 1e3 << " ms, output "
+                << times[k].output * 1e3 << " ms" << std::endl;
+    }
+  }
+
+  static std::string partPath(const std::string &stem, int worker) {
+    return "output/" + stem + ".part" + std::to_string(worker) + ".csv";
+  }
+
+  // Worker body: runs in the child process
+  void runWorker(int me, int timeSteps, pthread_barrier_t *barrier,
+                 std::vector<HaloRing> &rings, WorkerRecord *counts,
+                 size_t records, WorkerTimes &times) {
+    int w = plan.workers;
+    const std::vector<int> &mine = plan.owned[me];
+    size_t numClaims = sim.claims.size();
+    City &city = sim.city;
+    std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
+
+    bool spatial = sim.spatialFile.is_open();
+    if (spatial) {
+      sim.spatialFile.close();
+      sim.spatialFile.open(partPath("spatial_data", me));
+      sim.spatialIndex = SnapshotIndexWriter(); // The parent indexes the merge
+    }
+    // Arrow batches are written by the parent from the merged rows
+    sim.spatialArrow.abandon();
+    sim.resultsArrow.abandon();
+    sim.params.arrow_output = false;
+    if (sim.localFile.is_open()) {
+      sim.localFile.close();
+      sim.localFile.open(partPath("local_counts", me));
+    }
+    auto ownUnit = [&](size_t unit) {
+      return plan.townOwner[sim.localTown(unit)] == me;
+    };
+
+    // Demographic cells mix towns, so each worker counts its own agents
+    // and the parent sums the parts
+    if (!sim.demographics.empty()) {
+      sim.demographicFile.close();
+      sim.demographicFile.open(partPath("demographic_counts", me));
+      sim.demographics.reset(city.agents);
+      for (size_t c = 0; c < numClaims; ++c) {
+        sim.demographics.addClaim();
+        for (int id : mine)
+          sim.demographics.count(
+              c, id, city.agents[id].getState(sim.claims[c].claimId));
+      }
+    }
+
+    std::vector<SEDPNRState> &newStates = sim.nextStates;
+    newStates.resize(city.agents.size());
+    size_t record = 0;
+
+    // Counts and flows of this worker's own agents only. sim.local is
+    // updated for own agents too, so it is exact for the units of own towns
+    StateLedger ledger;
+
+    // Sampled dumps: each worker writes its own panel members and the
+    // bottom-k of its own candidates, which contains every row of the
+    // global sample; mergeSpatialParts() drops the rest
+    std::vector<int> myPanel;
+    for (int id : sim.sampler.panelAgents()) {
+      if (plan.townOwner[city.agents[id].homeTownId] == me)
+        myPanel.push_back(id);
+    }
+    auto externalId = [&](int id) { return city.externalId(id); };
+
+    for (size_t c = 0; c < numClaims; ++c) {
+      StateCounts initial;
+      for (int id : mine)
+        initial.add(city.agents[id].getState(sim.claims[c].claimId));
+      ledger.addClaim(initial);
+    }
+
+    Clock::time_point mark = Clock::now();
+    auto lap = [&](double &phase) {
+      Clock::time_point now = Clock::now();
+      phase += seconds(mark, now);
+      mark = now;
+    };
+
+    for (int step = 0; step < timeSteps; ++step) {
+      for (size_t c = 0; c < numClaims; ++c) {
+        int claimId = sim.claims[c].claimId;
+
+        for (int id : mine) {
+          Agent &agent = city.agents[id];
+          newStates[id] = sim.evaluateClaim(agent, c, uniformDist);
+          agent.incrementTimeInState(claimId);
+        }
+
+        // Apply, and send changed boundary states to their halo holders
+        for (int id : mine) {
+          SEDPNRState old = city.setAgentState(id, claimId, newStates[id]);
+          ledger.move(c, old, newStates[id]);
+          if (!sim.local.empty())
+            sim.local.move(c, city.agents[id], old, newStates[id]);
+          if (!sim.demographics.empty())
+            sim.demographics.move(c, id, old, newStates[id]);
+          uint64_t mask = plan.sendMask[id];
+          if (mask == 0 || old == newStates[id])
+            continue;
+          HaloUpdate update{id, static_cast<int32_t>(newStates[id])};
+          for (int dst = 0; dst < w; ++dst) {
+            if ((mask >> dst) & 1)
+              rings[static_cast<size_t>(me) * w + dst].push(update);
+          }
+        }
+
+        lap(times.transitions);
+        pthread_barrier_wait(barrier);
+        for (int src = 0; src < w; ++src) {
+          if (src == me)
+            continue;
+          rings[static_cast<size_t>(src) * w + me].drain(
+              [&](const HaloUpdate &u) {
+                city.setAgentState(u.agentId, claimId,
+                                   static_cast<SEDPNRState>(u.state));
+              });
+        }
+        pthread_barrier_wait(barrier);
+        lap(times.exchange);
+      }
+
+      if (sim.currentTime % sim.params.output_interval == 0) {
+        for (size_t c = 0; c < numClaims; ++c) {
+          WorkerRecord &out = counts[(me * numClaims + c) * records + record];
+          out.counts = ledger.current(c);
+          out.flows = ledger.takeFlows(c);
+        }
+        record++;
+      }
+      if (spatial && sim.currentTime % sim.params.spatial_interval == 0) {
+        bool everyAgent =
+            sim.params.full_spatial_snapshot || sim.currentTime == 0;
+        for (size_t c = 0; c < numClaims; ++c) {
+          const Claim &claim = sim.claims[c];
+          if (!sim.sampler.active()) {
+            for (int id : mine) {
+              SEDPNRState state = city.agents[id].getState(claim.claimId);
+              if (everyAgent || state != SEDPNRState::SUSCEPTIBLE)
+                sim.writeSpatialRow(city.agents[id], claim, state);
+            }
+            continue;
+          }
+          auto candidates = [&](auto offer) {
+            for (int id : mine) {
+              if (everyAgent || city.agents[id].getState(claim.claimId) !=
+                                    SEDPNRState::SUSCEPTIBLE)
+                offer(id);
+            }
+          };
+          sim.sampler.select(sim.currentTime, myPanel, candidates, externalId,
+                             sim.workList);
+          for (int id : sim.workList)
+            sim.writeSpatialRow(city.agents[id], claim,
+                                city.agents[id].getState(claim.claimId));
+        }
+      }
+      if (!sim.local.empty() &&
+          sim.currentTime % sim.params.local_counts_interval == 0)
+        sim.writeLocalCounts(sim.localFile, ownUnit);
+      if (!sim.demographics.empty() &&
+          sim.currentTime % sim.params.demographic_counts_interval == 0)
+        sim.writeDemographicCounts(sim.demographicFile);
+      sim.currentTime++;
+      lap(times.output);
+    }
+
+    if (spatial)
+      sim.spatialFile.close();
+    if (sim.localFile.is_open())
+      sim.localFile.close();
+    if (sim.demographicFile.is_open())
+      sim.demographicFile.close();
+  }
+
+  // Wait for every worker; if one fails the others would block on the
+  // barrier forever, so they are killed
+  static bool waitWorkers(std::vector<pid_t> &pids) {
+    bool ok = true;
+    size_t remaining = pids.size();
+    while (remaining > 0) {
+      int status = 0;
+      pid_t pid = wait(&status);
+      if (pid < 0)
+        break;
+      remaining--;
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (ok) {
+          std::cerr << "Error: partition worker " << pid
+                    << " failed; stopping the others" << std::endl;
+        }
+        ok = false;
+        stopWorkers(pids);
+      }
+    }
+    return ok;
+  }
+
+  static void stopWorkers(const std::vector<pid_t> &pids) {
+    for (pid_t pid : pids)
+      kill(pid, SIGKILL);
+  }
+
+  // Merge the per-worker snapshot files into the main spatial file in
+  // single-process row order: time, then claim order, then current agent ID
+  void mergeSpatialParts() {
+    if (!sim.spatialFile.is_open())
+      return;
+    auto key = [&](const std::string &line) {
+      int v[7] = {};
+      parseInts(line, v, 7);
+      // Rows carry external IDs
+      return RowKey(v[0], sim.claimIndexById[v[6]], sim.city.internalId(v[1]));
+    };
+    // Reservoir rows are kept only if their key is within the k smallest
+    // of their record and claim over all workers
+    const SpatialSampler &sampler = sim.sampler;
+    std::map<std::pair<int, int>, SpatialSampler::Key> cutoff;
+    if (sampler.usesReservoir()) {
+      std::map<std::pair<int, int>, std::vector<SpatialSampler::Key>> keys;
+      for (int k = 0; k < plan.workers; ++k) {
+        std::ifstream in(partPath("spatial_data", k));
+        std::string line;
+        while (std::getline(in, line)) {
+          int v[7] = {};
+          if (parseInts(line, v, 7) == 7 &&
+              !sampler.inPanel(sim.city.internalId(v[1])))
+            keys[{v[0], v[6]}].push_back(sampler.key(v[0], v[1]));
+        }
+      }
+      size_t k = sampler.reservoirSize();
+      for (auto &[record, list] : keys) {
+        if (list.size() <= k)
+          continue;
+        std::nth_element(list.begin(), list.begin() + (k - 1), list.end());
+        cutoff[record] = list[k - 1];
+      }
+    }
+
+    // The parent's index and Arrow copy see the merged rows in their
+    // final order, one Arrow batch per record as in a single-process run
+    bool arrow = sim.startArrow() && sim.spatialArrow.isOpen();
+    int batchTime = 0;
+    auto onRow = [&](const std::string &line) {
+      int v[11] = {};
+      if (parseInts(line, v, 11) != 11)
+        return true;
+      if (!cutoff.empty() && !sampler.inPanel(sim.city.internalId(v[1]))) {
+        auto limit = cutoff.find({v[0], v[6]});
+        if (limit != cutoff.end() && limit->second < sampler.key(v[0], v[1]))
+          return false;
+      }
+      if (sim.spatialIndex.isActive())
+        sim.spatialIndex.add(v[0], v[1], v[6], v[8] == 1,
+                             {v[2], v[3], v[4], v[5], v[9], v[10]}, v[7],
+                             line.size() + 1);
+      if (arrow) {
+        if (v[0] != batchTime)
+          sim.spatialArrow.writeBatch();
+        batchTime = v[0];
+        sim.appendSpatialArrow(v, sim.claimIndexById[v[6]]);
+      }
+      return true;
+    };
+    if (sim.spatialIndex.isActive() || arrow || !cutoff.empty())
+      mergeParts("spatial_data", sim.spatialFile, key, onRow);
+    else
+      mergeParts("spatial_data", sim.spatialFile, key);
+    if (arrow)
+      sim.spatialArrow.writeBatch();
+  }
+
+  // Same for the local count files: time, claim order, then unit (towns
+  // before locations)
+  void mergeLocalParts() {
+    if (!sim.localFile.is_open())
+      return;
+    int towns = static_cast<int>(sim.local.townCount());
+    mergeParts("local_counts", sim.localFile, [&](const std::string &line) {
+      int time = 0, claimId = 0, id = 0;
+      char level[16] = "";
+      std::sscanf(line.c_str(), "%d,%d,%15[^,],%d", &time, &claimId, level,
+                  &id);
+      int unit = std::strcmp(level, "town") == 0 ? id : towns + id;
+      return RowKey(time, sim.claimIndexById[claimId], unit);
+    });
+  }
+
+  // Sum the per-worker demographic files (time, claim order, cell). Each
+  // part lists only the cells that changed in that worker, so a merged row
+  // adds every other worker's last row for the cell; a cell a worker has no
+  // agents in is absent from its part and adds zero
+  void mergeDemographicParts() {
+    if (!sim.demographicFile.is_open())
+      return;
+    constexpr int FIELDS = 7; // Six state counts and EverInfected
+    using Values = std::array<long long, FIELDS>;
+    std::map<RowKey, std::vector<std::pair<int, Values>>> rows;
+    for (int k = 0; k < plan.workers; ++k) {
+      std::ifstream in(partPath("demographic_counts", k));
+      std::string line;
+      while (std::getline(in, line)) {
+        int time = 0, claimId = 0, eth = 0, denom = 0, age = 0;
+        Values v{};
+        if (std::sscanf(line.c_str(),
+                        "%d,%d,%d,%d,%d,%lld,%lld,%lld,%lld,%lld,%lld,%lld",
+                        &time, &claimId, &eth, &denom, &age, &v[0], &v[1],
+                        &v[2], &v[3], &v[4], &v[5], &v[6]) != 12)
+          continue;
+        int cell = demographicCell(static_cast<EthnicGroup>(eth),
+                                   static_cast<ReligiousDenomination>(denom),
+                                   static_cast<AgeGroup>(age));
+        rows[RowKey(time, sim.claimIndexById[claimId], cell)].push_back(
+            {k, v});
+      }
+      in.close();
+      std::remove(partPath("demographic_counts", k).c_str());
+    }
+    // (claim, cell) -> each worker's last row
+    std::map<std::pair<int, int>, std::vector<Values>> last;
+    for (const auto &[key, changed] : rows) {
+      auto &latest = last[{std::get<1>(key), std::get<2>(key)}];
+      if (latest.empty())
+        latest.assign(plan.workers, Values{});
+      for (const auto &[worker, v] : changed)
+        latest[worker] = v;
+      Values total{};
+      for (const Values &v : latest)
+        for (int f = 0; f < FIELDS; ++f)
+          total[f] += v[f];
+      int cell = std::get<2>(key);
+      sim.demographicFile << std::get<0>(key) << ","
+                          << sim.claims[std::get<1>(key)].claimId << ","
+                          << cell / (NUM_AGE_CELLS * NUM_DENOMINATION_CELLS)
+                          << ","
+                          << (cell / NUM_AGE_CELLS) % NUM_DENOMINATION_CELLS
+                          << "," << cell % NUM_AGE_CELLS;
+      for (long long v : total)
+        sim.demographicFile << "," << v;
+      sim.demographicFile << "\n";
+    }
+  }
+
+  using RowKey = std::tuple<int, int, int>;
+
+  // Leading comma-separated integers of a part-file row, up to n; returns
+  // how many were read. The spatial merge parses every row of the dump,
+  // where sscanf took most of the merge time
+  static int parseInts(const std::string &line, int *v, int n) {
+    const char *p = line.data(), *end = p + line.size();
+    int count = 0;
+    while (count < n) {
+      auto [next, ec] = std::from_chars(p, end, v[count]);
+      if (ec != std::errc())
+        break;
+      count++;
+      if (next == end || *next != ',')
+        break;
+      p = next + 1;
+    }
+    return count;
+  }
+
+  // K-way merge of the per-worker part files of one output into out,
+  // ordered by key(row); each part is already in key order. onRow(row) is
+  // called for every row in merged order and the row is written only if
+  // it returns true. The part files are removed afterwards
+  template <typename KeyFn>
+  void mergeParts(const std::string &stem, std::ostream &out, KeyFn key) {
+    mergeParts(stem, out, key, [](const std::string &) { return true; });
+  }
+
+  template <typename KeyFn, typename RowFn>
+  void mergeParts(const std::string &stem, std::ostream &out, KeyFn key,
+                  RowFn onRow) {
+    struct Part {
+      std::ifstream in;
+      std::string line;
+      RowKey key;
+      bool live = false;
+    };
+    std::vector<Part> parts(plan.workers);
+
+    auto advance = [&](Part &p) {
+      p.live = static_cast<bool>(std::getline(p.in, p.line));
+      if (p.live)
+        p.key = key(p.line);
+    };
+
+    for (int k = 0; k < plan.workers; ++k) {
+      parts[k].in.open(partPath(stem, k));
+      advance(parts[k]);
+    }
+
+    for (;;) {
+      Part *next = nullptr;
+      for (auto &p : parts) {
+        if (p.live && (!next || p.key < next->key))
+          next = &p;
+      }
+      if (!next)
+        break;
+      if (onRow(next->line))
+        out << next->line << '\n';
+      advance(*next);
+    }
+
+    for (int k = 0; k < plan.workers; ++k) {
+      parts[k].in.close();
+      std::remove(partPath(stem, k).c_str());
+    }
+  }
+
+  Simulation &sim;
+  PartitionPlan plan;
+};
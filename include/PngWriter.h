@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// PNG WRITER
+// Self-contained RGBA PNG encoder for headless frame export. Rows are
+// stored unfiltered and compressed as one fixed-Huffman deflate block whose
+// only matches repeat the previous pixel or the pixel above. That is
+// enough for rendered frames, which are mostly flat background, and keeps
+// encoding to a single linear pass.
+// ============================================================================
+
+namespace png_detail {
+
+inline const std::array<uint32_t, 256> &crcTable() {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+    return t;
+  }();
+  return table;
+}
+
+inline uint32_t crc32(const uint8_t *data, size_t n, uint32_t crc = 0) {
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i)
+    crc = crcTable()[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+inline uint32_t adler32(const uint8_t *data, size_t n) {
+  uint32_t a = 1, b = 0;
+  while (n > 0) {
+    size_t block = n < 5552 ? n : 5552;
+    n -= block;
+    while (block--) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+// LSB-first bit packer, as deflate requires
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+  void bits(uint32_t value, int count) {
+    acc |= static_cast<uint64_t>(value) << used;
+    used += count;
+    while (used >= 8) {
+      out.push_back(static_cast<uint8_t>(acc));
+      acc >>= 8;
+      used -= 8;
+    }
+  }
+
+  // Huffman codes are sent most significant bit first
+  void code(uint32_t value, int count) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < count; ++i)
+      reversed |= ((value >> i) & 1) << (count - 1 - i);
+    bits(reversed, count);
+  }
+
+  void flush() {
+    if (used > 0)
+      out.push_back(static_cast<uint8_t>(acc));
+    acc = 0;
+    used = 0;
+  }
+
+private:
+  std::vector<uint8_t> &out;
+  uint64_t acc = 0;
+  int used = 0;
+};
+
+inline void literal(BitWriter &w, int sym) {
+  if (sym < 144)
+    w.code(0x30 + sym, 8);
+  else if (sym < 256)
+    w.code(0x190 + sym - 144, 9);
+  else if (sym < 280)
+    w.code(sym - 256, 7);
+  else
+    w.code(0xC0 + sym - 280, 8);
+}
+
+inline void match(BitWriter &w, int length, int distance) {
+  static const int lenBase[29] = {3,  4,  5,  6,   7,   8,   9,   10,  11, 13,
+                                  15, 17, 19, 23,  27,  31,  35,  43,  51, 59,
+                                  67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const int lenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                   1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                   4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static const int distBase[30] = {
+      1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+      33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+      1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+  int l = 28;
+  while (lenBase[l] > length)
+    --l;
+  literal(w, 257 + l);
+  w.bits(length - lenBase[l], lenExtra[l]);
+  int d = 29;
+  while (distBase[d] > distance)
+    --d;
+  w.code(d, 5);
+  w.bits(distance - distBase[d], d < 4 ? 0 : d / 2 - 1);
+}
+
+// zlib stream of `data` with one fixed-Huffman block
+inline std::vector<uint8_t> deflate(const std::vector<uint8_t> &data,
+                                    size_t stride) {
+  std::vector<uint8_t> out = {0x78, 0x01};
+  BitWriter w(out);
+  w.bits(1, 1); // Final block
+  w.bits(1, 2); // Fixed Huffman codes
+  const size_t n = data.size();
+  const size_t distances[2] = {4, stride};
+  size_t i = 0;
+  while (i < n) {
+    size_t bestLen = 0, bestDist = 0;
+    for (size_t d : distances) {
+      if (d == 0 || d > i || d > 32768)
+        continue;
+      size_t len = 0;
+      while (len < 258 && i + len < n && data[i + len] == data[i + len - d])
+        ++len;
+      if (len > bestLen) {
+        bestLen = len;
+        bestDist = d;
+      }
+    }
+    if (bestLen >= 3) {
+      match(w, static_cast<int>(bestLen), static_cast<int>(bestDist));
+      i += bestLen;
+    } else {
+      literal(w, data[i++]);
+    }
+  }
+  literal(w, 256); // End of block
+  w.flush();
+  uint32_t adler = adler32(data.data(), n);
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out.push_back(static_cast<uint8_t>(adler >> shift));
+  return out;
+}
+
+inline void put32(std::vector<uint8_t> &out, uint32_t v) {
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out.push_back(static_cast<uint8_t>(v >> shift));
+}
+
+inline void chunk(std::vector<uint8_t> &out, const char *type,
+                  const std::vector<uint8_t> &body) {
+  put32(out, static_cast<uint32_t>(body.size()));
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), body.begin(), body.end());
+  put32(out, crc32(out.data() + start, out.size() - start));
+}
+
+} // namespace png_detail
+
+// Encode width x height RGBA pixels (row-major, 4 bytes each) as PNG
+inline std::vector<uint8_t> encodePng(const uint8_t *rgba, int width,
+                                      int height) {
+  using namespace png_detail;
+  size_t rowBytes = static_cast<size_t>(width) * 4;
+  std::vector<uint8_t> raw;
+  raw.reserve((rowBytes + 1) * height);
+  for (int y = 0; y < height; ++y) {
+    raw.push_back(0); // Filter: none
+    raw.insert(raw.end(), rgba + y * rowBytes, rgba + (y + 1) * rowBytes);
+  }
+
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  std::vector<uint8_t> header;
+  put32(header, static_cast<uint32_t>(width));
+  put32(header, static_cast<uint32_t>(height));
+  header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA
+  chunk(png, "IHDR", header);
+  chunk(png, "IDAT", deflate(raw, rowBytes + 1));
+  chunk(png, "IEND", {});
+  return png;
+}
+
+inline bool writePng(const std::string &path, const uint8_t *rgba, int width,
+                     int height) {
+  std::vector<uint8_t> png = encodePng(rgba, width, height);
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = std::fwrite(png.data(), 1, png.size(), f) == png.size();
+  return std::fclose(f) == 0 && ok;
+}
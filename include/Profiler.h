@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// ============================================================================
+// PHASE PROFILER
+// Monotonic-clock timers around the phases of initialize() and step().
+// Only compiled in when SIM_PROFILE is defined (make PROFILE=1); otherwise
+// every PROFILE_* macro below expands to nothing.
+// ============================================================================
+
+// Last-level cache misses of this process (user space) from a Linux
+// perf_event counter. Containers and VMs often hide hardware counters, in
+// which case available() is false and misses are not reported.
+class CacheMissCounter {
+public:
+  CacheMissCounter() {
+#ifdef __linux__
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)); // This thread
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  ~CacheMissCounter() {
+#ifdef __linux__
+    if (fd >= 0)
+      close(fd);
+#endif
+  }
+
+  CacheMissCounter(const CacheMissCounter &) = delete;
+  CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+  bool available() const { return fd >= 0; }
+
+  // Running total since the counter was opened (0 if unavailable)
+  uint64_t read() const {
+    uint64_t value = 0;
+#ifdef __linux__
+    if (fd >= 0 && ::read(fd, &value, sizeof(value)) != sizeof(value))
+      value = 0;
+#endif
+    return value;
+  }
+
+private:
+  int fd = -1;
+};
+
+enum class Phase {
+  INIT_TOWNS = 0,
+  INIT_POPULATION,
+  INIT_NETWORK,
+  INIT_REORDER,
+  TRANSITIONS,
+  HUB_AGGREGATE,
+  RECORD_COUNTS,
+  LOCAL_COUNTS,
+  DEMOGRAPHIC_COUNTS,
+  SPATIAL_SNAPSHOT,
+  LIVE_PUBLISH,
+  PRUNE_REWIRE,
+  STEP_TOTAL,
+  NUM_PHASES
+};
+
+inline const char *phaseToString(Phase phase) {
+  switch (phase) {
+  case Phase::INIT_TOWNS:
+    return "init_towns";
+  case Phase::INIT_POPULATION:
+    return "init_population";
+  case Phase::INIT_NETWORK:
+    return "init_network";
+  case Phase::INIT_REORDER:
+    return "init_reorder";
+  case Phase::TRANSITIONS:
+    return "transitions";
+  case Phase::HUB_AGGREGATE:
+    return "hub_aggregate";
+  case Phase::RECORD_COUNTS:
+    return "record_counts";
+  case Phase::LOCAL_COUNTS:
+    return "local_counts";
+  case Phase::DEMOGRAPHIC_COUNTS:
+    return "demographic_counts";
+  case Phase::SPATIAL_SNAPSHOT:
+    return "spatial_snapshot";
+  case Phase::LIVE_PUBLISH:
+    return "live_publish";
+  case Phase::PRUNE_REWIRE:
+    return "prune_rewire";
+  case Phase::STEP_TOTAL:
+    return "step_total";
+  default:
+    return "unknown";
+  }
+}
+
+class Profiler {
+public:
+  static constexpr int NUM_PHASES = static_cast<int>(Phase::NUM_PHASES);
+  using Clock = std::chrono::steady_clock;
+
+  // Summary statistics for one phase (all durations in nanoseconds)
+  struct PhaseStats {
+    size_t calls = 0;
+    int64_t total = 0;
+    double mean = 0.0;
+    int64_t p50 = 0;
+    int64_t p99 = 0;
+    int64_t max = 0;
+  };
+
+  static Profiler &instance() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  // Phases timed once per claim in every step rather than once per step
+  static bool perClaim(Phase phase) { return phase == Phase::HUB_AGGREGATE; }
+
+  // Pre-size sample buffers so recording never reallocates mid-run
+  void reserve(int steps, size_t claims) {
+    size_t n = static_cast<size_t>(std::max(0, steps));
+    for (int i = 0; i < NUM_PHASES; ++i)
+      samples[i].reserve(perClaim(static_cast<Phase>(i)) ? n * claims : n);
+    stepRows.reserve(n);
+  }
+
+  void record(Phase phase, int64_t ns, uint64_t llcMisses = 0) {
+    int idx = static_cast<int>(phase);
+    samples[idx].push_back(ns);
+    currentStep[idx] += ns;
+    misses[idx] += llcMisses;
+  }
+
+  const CacheMissCounter &cacheMisses() const { return missCounter; }
+
+  // Agents visited by the transition phase (for misses per agent-step)
+  void addAgentSteps(uint64_t n) { agentSteps += n; }
+
+  // Close the per-step breakdown row for the current step
+  void endStep() {
+    stepRows.push_back(currentStep);
+    currentStep.fill(0);
+  }
+
+  PhaseStats stats(Phase phase) const {
+    PhaseStats st;
+    const auto &s = samples[static_cast<int>(phase)];
+    if (s.empty())
+      return st;
+
+    std::vector<int64_t> sorted = s;
+    std::sort(sorted.begin(), sorted.end());
+    st.calls = sorted.size();
+    for (int64_t v : sorted)
+      st.total += v;
+    st.mean = static_cast<double>(st.total) / st.calls;
+    st.p50 = sorted[(sorted.size() - 1) / 2];
+    st.p99 = sorted[static_cast<size_t>((sorted.size() - 1) * 0.99)];
+    st.max = sorted.back();
+    return st;
+  }
+
+  // ========================================================================
+  // REPORTING
+  // ========================================================================
+
+  void printSummary(std::ostream &out = std::cout) const {
+    out << "\n=== Performance Summary ===" << std::endl;
+    out << std::left << std::setw(18) << "Phase" << std::right
+        << std::setw(8) << "Calls" << std::setw(12) << "Total(ms)"
+        << std::setw(12) << "Mean(us)" << std::setw(12) << "p50(us)"
+        << std::setw(12) << "p99(us)" << std::setw(12) << "Max(us)"
+        << std::endl;
+    out << std::string(86, '-') << std::endl;
+
+    out << std::fixed << std::setprecision(2);
+    for (int i = 0; i < NUM_PHASES; ++i) {
+      Phase phase = static_cast<Phase>(i);
+      PhaseStats st = stats(phase);
+      if (st.calls == 0)
+        continue;
+      out << std::left << std::setw(18) << phaseToString(phase) << std::right
+          << std::setw(8) << st.calls << std::setw(12) << st.total / 1e6
+          << std::setw(12) << st.mean / 1e3 << std::setw(12) << st.p50 / 1e3
+          << std::setw(12) << st.p99 / 1e3 << std::setw(12) << st.max / 1e3
+          << std::endl;
+    }
+
+    if (!missCounter.available()) {
+      out << "LLC misses: unavailable (no hardware perf counters)"
+          << std::endl;
+    } else {
+      out << "LLC misses:";
+      for (int i = 0; i < NUM_PHASES; ++i) {
+        if (misses[i] > 0)
+          out << " " << phaseToString(static_cast<Phase>(i)) << "="
+              << misses[i];
+      }
+      out << std::endl;
+      if (agentSteps > 0) {
+        out << "LLC misses per agent-step (transitions): "
+            << std::setprecision(4)
+            << static_cast<double>(
+                   misses[static_cast<int>(Phase::TRANSITIONS)]) /
+                   agentSteps
+            << std::endl;
+      }
+    }
+    out << std::defaultfloat;
+  }
+
+  void writeJson(const std::string &filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+      std::cerr << "Error: Could not open performance file: " << filename
+                << std::endl;
+      return;
+    }
+
+    file << "{\n  \"unit\": \"ns\",\n  \"steps\": " << stepRows.size()
+         << ",\n  \"phases\": [";
+    bool first = true;
+    for (int i = 0; i < NUM_PHASES; ++i) {
+      Phase phase = static_cast<Phase>(i);
+      PhaseStats st = stats(phase);
+      if (st.calls == 0)
+        continue;
+      file << (first ? "\n" : ",\n") << "    {\"name\": \""
+           << phaseToString(phase) << "\", \"calls\": " << st.calls
+           << ", \"total\": " << st.total << ", \"mean\": " << std::fixed
+           << std::setprecision(1) << st.mean << std::defaultfloat
+           << ", \"p50\": " << st.p50 << ", \"p99\": " << st.p99
+           << ", \"max\": " << st.max;
+      if (missCounter.available() && phase == Phase::TRANSITIONS)
+        file << ", \"llc_misses\": " << misses[i];
+      file << "}";
+      first = false;
+    }
+    file << "\n  ]";
+    if (missCounter.available())
+      file << ",\n  \"agent_steps\": " << agentSteps;
+    file << "\n}\n";
+    std::cout << "Performance report written to: " << filename << std::endl;
+  }
+
+  // One row per step, one column per phase (nanoseconds)
+  void writeStepBreakdown(const std::string &filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+      std::cerr << "Error: Could not open step timing file: " << filename
+                << std::endl;
+      return;
+    }
+
+    file << "Step";
+    for (int i = static_cast<int>(Phase::TRANSITIONS); i < NUM_PHASES; ++i)
+      file << "," << phaseToString(static_cast<Phase>(i));
+    file << "\n";
+
+    for (size_t t = 0; t < stepRows.size(); ++t) {
+      file << t;
+      for (int i = static_cast<int>(Phase::TRANSITIONS); i < NUM_PHASES; ++i)
+        file << "," << stepRows[t][i];
+      file << "\n";
+    }
+    std::cout << "Step timings written to: " << filename << std::endl;
+  }
+
+  void report(bool stepBreakdown) const {
+    printSummary();
+    writeJson("output/performance.json");
+    if (stepBreakdown)
+      writeStepBreakdown("output/step_timings.csv");
+  }
+
+private:
+  Profiler() {
+    currentStep.fill(0);
+    misses.fill(0);
+  }
+
+  std::array<std::vector<int64_t>, NUM_PHASES> samples;
+  std::array<int64_t, NUM_PHASES> currentStep;
+  std::array<uint64_t, NUM_PHASES> misses;
+  uint64_t agentSteps = 0;
+  CacheMissCounter missCounter;
+  std::vector<std::array<int64_t, NUM_PHASES>> stepRows;
+};
+
+// RAII timer: records the elapsed time of its enclosing scope, and its LLC
+// misses for the transitions phase. Each counter read is a syscall, so the
+// other (often tiny) scopes do not read it
+class ScopedPhaseTimer {
+public:
+  explicit ScopedPhaseTimer(Phase p)
+      : phase(p), countMisses(p == Phase::TRANSITIONS),
+        startMisses(countMisses ? Profiler::instance().cacheMisses().read()
+                                : 0),
+        start(Profiler::Clock::now()) {}
+
+  ~ScopedPhaseTimer() {
+    auto elapsed = Profiler::Clock::now() - start;
+    Profiler &profiler = Profiler::instance();
+    profiler.record(
+        phase,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+        countMisses ? profiler.cacheMisses().read() - startMisses : 0);
+  }
+
+  ScopedPhaseTimer(const ScopedPhaseTimer &) = delete;
+  ScopedPhaseTimer &operator=(const ScopedPhaseTimer &) = delete;
+
+private:
+  Phase phase;
+  bool countMisses;
+  uint64_t startMisses;
+  Profiler::Clock::time_point start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SIM_PROFILE
+#define PROFILE_PHASE(phase)                                                   \
+  ScopedPhaseTimer PROFILE_CONCAT(phaseTimer_, __LINE__)(phase)
+#define PROFILE_RESERVE(steps, claims)                                         \
+  Profiler::instance().reserve(steps, claims)
+#define PROFILE_END_STEP() Profiler::instance().endStep()
+#define PROFILE_AGENT_STEPS(n) Profiler::instance().addAgentSteps(n)
+#define PROFILE_REPORT(stepBreakdown) Profiler::instance().report(stepBreakdown)
+#else
+#define PROFILE_PHASE(phase)
+#define PROFILE_RESERVE(steps, claims)
+#define PROFILE_END_STEP()
+#define PROFILE_AGENT_STEPS(n)
+#define PROFILE_REPORT(stepBreakdown)
+#endif
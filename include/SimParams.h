@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Claim.h"
+#include "Configuration.h"
+#include <algorithm>
+#include <cmath>
+
+// ============================================================================
+// FROZEN PARAMETER BLOCK
+// Immutable, cache-line-aligned snapshot of Configuration compiled once after
+// load(). Hot loops take it by reference instead of going through
+// Configuration::instance(), and run-constant terms are precomputed here.
+// ============================================================================
+
+struct alignas(64) SimParams {
+  // Similarity bonuses (see Agent::similarityMask)
+  static constexpr int SIMILARITY_MASKS = 16;
+
+  // Social network
+  int max_connections = 0;
+  double base_interaction_prob = 0.0;
+  double same_school_weight = 0.0;
+  double same_religious_weight = 0.0;
+  double same_workplace_weight = 0.0;
+  double same_town_weight = 0.0;
+  double age_group_weight = 0.0;
+  double ethnicity_weight = 0.0;
+
+  // SEDPNR transitions
+  double prob_s_to_e = 0.0;
+  double log_keep_s_to_e = 0.0; // log1p(-prob_s_to_e)
+  double prob_e_to_d = 0.0;
+  double prob_d_to_p = 0.0;
+  double prob_d_to_n = 0.0;
+  double prob_d_to_r = 0.0;
+  double prob_p_to_n = 0.0;
+  double prob_p_to_r = 0.0;
+  double prob_n_to_r = 0.0;
+  double misinfo_multiplier = 1.0;
+
+  // pow(similarity, homophily_strength) for every similarity mask
+  double similarityWeight[SIMILARITY_MASKS] = {};
+
+  // Hub mean-field exposure (see HubField): per-hub weights for school,
+  // religious site and workplace, and the separable similarity bonus of
+  // each single trait (ethnicity, religion, age, education)
+  bool hub_exposure = false;
+  double hubTypeWeight[3] = {};
+  double hubBonus[4] = {};
+
+  // Step control
+  int timesteps = 0;
+  int output_interval = 1;
+  int connection_patience = 0;
+  int memory_sample_interval = 0;
+  bool enable_connection_pruning = false;
+  bool full_spatial_snapshot = false;
+  bool local_counts = false;
+  bool demographic_counts = false;
+  bool spatial_index = false;
+  bool arrow_output = false;
+  int spatial_panel_size = 0;
+  int spatial_panel_strata = 0; // PanelStrata
+  int spatial_reservoir_size = 0;
+  int spatial_interval = 1; // Resolved: never 0
+  int local_counts_interval = 1;
+  int demographic_counts_interval = 1;
+  bool live_view = false;
+  bool sparse_engine = false;
+  bool counter_rng = false;
+  bool reorder_agents = false;
+  int partitions = 1;
+
+  static SimParams compile(const Configuration &cfg) {
+    SimParams p;
+    p.max_connections = cfg.max_connections;
+    p.base_interaction_prob = cfg.base_interaction_prob;
+    p.same_school_weight = cfg.same_school_weight;
+    p.same_religious_weight = cfg.same_religious_weight;
+    p.same_workplace_weight = cfg.same_workplace_weight;
+    p.same_town_weight = cfg.same_town_weight;
+    p.age_group_weight = cfg.age_group_weight;
+    p.ethnicity_weight = cfg.ethnicity_weight;
+
+    p.prob_s_to_e = cfg.prob_s_to_e;
+    p.log_keep_s_to_e = std::log1p(-cfg.prob_s_to_e);
+    p.prob_e_to_d = cfg.prob_e_to_d;
+    p.prob_d_to_p = cfg.prob_d_to_p;
+    p.prob_d_to_n = cfg.prob_d_to_n;
+    p.prob_d_to_r = cfg.prob_d_to_r;
+    p.prob_p_to_n = cfg.prob_p_to_n;
+    p.prob_p_to_r = cfg.prob_p_to_r;
+    p.prob_n_to_r = cfg.prob_n_to_r;
+    p.misinfo_multiplier = cfg.misinfo_multiplier;
+
+    // Summed in the same order as Agent::calculateSimilarity
+    for (int mask = 0; mask < SIMILARITY_MASKS; ++mask) {
+      double score = 1.0;
+      if (mask & 1)
+        score += 0.2; // Ethnicity
+      if (mask & 2)
+        score += 0.2; // Religion
+      if (mask & 4)
+        score += 0.1; // Age within 10 years
+      if (mask & 8)
+        score += 0.1; // Education within 1 level
+      p.similarityWeight[mask] = std::pow(score, cfg.homophily_strength);
+    }
+
+    p.hub_exposure = cfg.hub_exposure;
+    p.hubTypeWeight[0] = cfg.hub_exposure_weight * cfg.same_school_weight;
+    p.hubTypeWeight[1] = cfg.hub_exposure_weight * cfg.same_religious_weight;
+    p.hubTypeWeight[2] = cfg.hub_exposure_weight * cfg.same_workplace_weight;
+    for (int trait = 0; trait < 4; ++trait) {
+      p.hubBonus[trait] =
+          p.similarityWeight[1 << trait] - p.similarityWeight[0];
+    }
+
+    p.timesteps = cfg.timesteps;
+    p.output_interval = std::max(1, cfg.output_interval);
+    p.connection_patience = cfg.connection_patience;
+    p.memory_sample_interval = cfg.memory_sample_interval;
+    p.enable_connection_pruning = cfg.enable_connection_pruning;
+    p.full_spatial_snapshot = cfg.full_spatial_snapshot;
+    p.local_counts = cfg.local_counts;
+    p.demographic_counts = cfg.demographic_counts;
+    p.spatial_index = cfg.spatial_index;
+    p.arrow_output = cfg.arrow_output;
+    p.spatial_panel_size = std::max(0, cfg.spatial_panel_size);
+    p.spatial_panel_strata =
+        cfg.spatial_panel_strata >= 0 && cfg.spatial_panel_strata <= 2
+            ? cfg.spatial_panel_strata
+            : 0;
+    p.spatial_reservoir_size = std::max(0, cfg.spatial_reservoir_size);
+    // Output intervals default to output_interval
+    auto interval = [&](int steps) {
+      return steps > 0 ? steps : p.output_interval;
+    };
+    p.spatial_interval = interval(cfg.spatial_interval);
+    p.local_counts_interval = interval(cfg.local_counts_interval);
+    p.demographic_counts_interval = interval(cfg.demographic_counts_interval);
+    p.live_view = cfg.live_view;
+    p.sparse_engine = cfg.sparse_engine;
+    p.counter_rng = cfg.counter_rng;
+    p.reorder_agents = cfg.reorder_agents;
+    p.partitions = std::max(1, cfg.partitions);
+    return p;
+  }
+};
+
+// ============================================================================
+// PER-CLAIM PARAMETERS
+// Transition probabilities with the claim's stance and threshold folded in
+// ============================================================================
+
+struct alignas(64) ClaimParams {
+  bool isMisinformation = false;
+
+  // Exposure: P(S->E) = 1 - exp(effectiveExposure * exposureLogKeep)
+  double exposureLogKeep = 0.0;
+
+  double probEtoD = 0.0;
+  double probReject = 0.0;    // D -> R (misinformation only)
+  double probPropagate = 0.0; // D -> P before the belief multiplier
+  double probNotSpread = 0.0; // D -> N
+  double probPtoR = 0.0;      // Misinformation only
+  double probPtoN = 0.0;
+  double probNtoR = 0.0; // Misinformation only
+
+  static ClaimParams compile(const SimParams &p, const Claim &claim) {
+    ClaimParams c;
+    c.isMisinformation = claim.isMisinformation;
+
+    // Misinformation spreads faster through more effective exposure
+    double multiplier = claim.isMisinformation ? p.misinfo_multiplier : 1.0;
+    c.exposureLogKeep = multiplier * p.log_keep_s_to_e;
+
+    // Truth claims are never rejected or recovered from
+    c.probEtoD = p.prob_e_to_d;
+    c.probReject = claim.isMisinformation ? p.prob_d_to_r : 0.0;
+    c.probPropagate = p.prob_d_to_p * (1.0 - claim.adoptionThreshold);
+    c.probNotSpread = p.prob_d_to_n;
+    c.probPtoR = claim.isMisinformation ? p.prob_p_to_r : 0.0;
+    c.probPtoN = p.prob_p_to_n;
+    c.probNtoR = claim.isMisinformation ? p.prob_n_to_r : 0.0;
+    return c;
+  }
+};
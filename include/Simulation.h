@@ -1,9 +1,21 @@
 #pragma once
 
+#include "ArrowWriter.h"
 #include "City.h"
 #include "Claim.h"
 #include "Configuration.h"
+#include "CounterRng.h"
+#include "HubField.h"
+#include "LiveView.h"
+#include "MemoryReport.h"
+#include "Profiler.h"
 #include "SEDPNR.h"
+#include "SimParams.h"
+#include "SnapshotIndex.h"
+#include "SpatialSampler.h"
+#include "StateLedger.h"
+#include <charconv>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -12,24 +24,21 @@
 #include <string>
 #include <vector>
 
-// Note: Simulation parameters are now managed by Configuration::instance()
+// Note: Simulation parameters are compiled from Configuration::instance()
+// into a frozen SimParams block at construction and in initialize()
 
 // ============================================================================
-// STATE COUNTS STRUCTURE
+// CLAIM ACTIVITY
+// Sparse per-claim record used by the agent-major engine: only agents that
+// have left Susceptible for the claim are listed
 // ============================================================================
 
-struct StateCounts {
-  int susceptible = 0;
-  int exposed = 0;
-  int doubtful = 0;
-  int propagating = 0;
-  int notSpreading = 0;
-  int recovered = 0;
+struct ClaimActivity {
+  std::pmr::vector<int> agents;      // Non-Susceptible, in order of arrival
+  std::pmr::vector<int> propagators; // Rebuilt at the start of every step
 
-  int total() const {
-    return susceptible + exposed + doubtful + propagating + notSpreading +
-           recovered;
-  }
+  explicit ClaimActivity(std::pmr::memory_resource *mem)
+      : agents(mem), propagators(mem) {}
 };
 
 // ============================================================================
@@ -42,9 +51,16 @@ public:
   // City containing agents
   City city;
 
+  // Outcome of the last initialize()'s agent reordering (reorder_agents)
+  ReorderStats reorderStats;
+
   // Claims being simulated
   std::vector<Claim> claims;
 
+  // Frozen run parameters, and per-claim parameters parallel to claims
+  SimParams params;
+  std::vector<ClaimParams> claimParams;
+
   // Current simulation time
   int currentTime;
 
@@ -52,17 +68,101 @@ public:
   // claim_id -> time -> counts
   std::map<int, std::vector<StateCounts>> stateHistory;
 
+  // Transition flows over time for each claim, parallel to stateHistory:
+  // each entry holds the flows since the previous record
+  std::map<int, std::vector<FlowMatrix>> flowHistory;
+
+  // Live counts and pending flows per claim (index in claims), maintained
+  // by applyState()
+  StateLedger ledger;
+
+  // Per-town and per-location counts (local_counts=true), written to
+  // localFile at every record
+  LocalLedger local;
+  std::ofstream localFile;
+
+  // Per-claim counts by ethnicity x denomination x age group
+  // (demographic_counts=true), written to demographicFile at every record
+  DemographicLedger demographics;
+  std::ofstream demographicFile;
+
+  // Shared-memory ring the visualizer can watch (live_view=true)
+  LivePublisher live;
+  bool liveFailed = false;
+
   // Random number generator
   std::mt19937 rng;
+
+  // Per-evaluation streams used instead of rng by the transition rules when
+  // counter_rng is on (see CounterRng.h)
+  CounterRng drawStream;
+  unsigned int runSeed;
   std::ofstream spatialFile;
 
+  // Time, agent and location index of spatialFile (spatial_index=true),
+  // saved by outputSpatialIndex()
+  SnapshotIndexWriter spatialIndex;
+
+  // Panel and reservoir sampling of spatialFile (see SpatialSampler.h)
+  SpatialSampler sampler;
+
+  // Arrow IPC copies of spatial_data.csv and simulation_results.csv
+  // (arrow_output=true), one record batch per record. They are opened at
+  // the first record, once the claims (their name dictionary) are known
+  ArrowFileWriter spatialArrow;
+  ArrowFileWriter resultsArrow;
+  bool arrowStarted = false;
+  size_t arrowClaims = 0; // Claim names already in the dictionaries
+
+  // Live/peak heap usage per structure (see sampleMemory())
+  MemoryReport memory;
+
+  // Per-step scratch buffers, sized once and reused so that steady-state
+  // steps do not allocate (the engine is single-threaded, so one set)
+  std::vector<SEDPNRState> nextStates;
+  std::vector<int> pruneScratch;
+
+  // Per-location propagator aggregates (only sized when hub_exposure is on)
+  HubField hubs;
+
+  // claimId -> index in claims (-1 for unused IDs)
+  std::vector<int> claimIndexById;
+
+  // Sparse agent-major engine state (sparse_engine=true); activity is
+  // parallel to claims and rebuilt from the agents whenever claims change
+  std::vector<ClaimActivity> activity;
+  bool activityValid = false;
+
+  struct NeighborTally {
+    size_t stamp = 0; // tallyGen of the agent that last touched it
+    double exposure = 0.0;
+    bool reinforced = false;
+  };
+  struct PendingChange {
+    int agentId;
+    int claim; // Index in claims
+    SEDPNRState state;
+  };
+  std::vector<NeighborTally> tally; // Per claim, for the agent being evaluated
+  std::vector<int> tallyTouched;
+  std::vector<int> workList;
+  std::vector<size_t> workStamp; // Per agent: workGen when last listed
+  std::vector<PendingChange> pending;
+  size_t tallyGen = 0;
+  size_t workGen = 0;
+
   // Constructor
-  Simulation(unsigned int seed = 42) : currentTime(0), rng(seed) {
+  Simulation(unsigned int seed = 42)
+      : params(SimParams::compile(Configuration::instance())), currentTime(0),
+        rng(seed), runSeed(seed) {
     spatialFile.open("output/spatial_data.csv");
     if (spatialFile.is_open()) {
-      spatialFile
-          << "Time,AgentId,TownId,SchoolId,ReligiousId,WorkplaceId,ClaimId,"
-             "State,IsMisinformation,Ethnicity,Denomination\n";
+      spatialFile << SPATIAL_HEADER;
+      if (params.spatial_index)
+        spatialIndex.start(std::char_traits<char>::length(SPATIAL_HEADER),
+                           params.full_spatial_snapshot,
+                           params.spatial_panel_size > 0 ||
+                               params.spatial_reservoir_size > 0);
     }
   }
 
@@ -70,6 +170,12 @@ public:
     if (spatialFile.is_open()) {
       spatialFile.close();
     }
+    if (localFile.is_open()) {
+      localFile.close();
+    }
+    if (demographicFile.is_open()) {
+      demographicFile.close();
+    }
   }
 
   // ========================================================================
@@ -77,12 +183,78 @@ public:
   // ========================================================================
 
   void initialize(int population) {
-    city = City(rng());
-    city.generateTowns();
-    city.generatePopulation(population);
-    city.generateNetwork();
+    params = SimParams::compile(Configuration::instance());
+    if (params.sparse_engine && params.hub_exposure) {
+      std::cerr << "Warning: hub_exposure is not supported by the sparse "
+                   "engine and is ignored"
+                << std::endl;
+      params.hub_exposure = false;
+    }
+
+    // Activity lists hold memory from the old city's arena
+    activity.clear();
+    activityValid = false;
+    city = City(rng(), params);
+    {
+      PROFILE_PHASE(Phase::INIT_TOWNS);
+      city.generateTowns();
+    }
+    {
+      PROFILE_PHASE(Phase::INIT_POPULATION);
+      city.generatePopulation(population);
+    }
+    {
+      PROFILE_PHASE(Phase::INIT_NETWORK);
+      city.generateNetwork();
+    }
+    reorderStats = ReorderStats();
+    if (params.reorder_agents) {
+      PROFILE_PHASE(Phase::INIT_REORDER);
+      reorderStats = city.reorderAgents();
+    }
+    if (spatialIndex.isActive() && params.timesteps > 0)
+      spatialIndex.reserve(
+          static_cast<size_t>(params.timesteps / params.spatial_interval + 1),
+          city.agents.size());
+    sampler.configure(params.spatial_panel_size,
+                      static_cast<PanelStrata>(params.spatial_panel_strata),
+                      params.spatial_reservoir_size, runSeed, city);
+    if (sampler.active())
+      workList.reserve(sampler.maxRows()); // select()'s output each record
     currentTime = 0;
     stateHistory.clear();
+    flowHistory.clear();
+    ledger.clear();
+    local = LocalLedger();
+    if (params.local_counts) {
+      local.reset(city.towns.size(), city.locations.size());
+      if (!localFile.is_open()) {
+        localFile.open("output/local_counts.csv");
+        if (localFile.is_open()) {
+          localFile << "Time,ClaimId,Level,Id,Susceptible,Exposed,Doubtful,"
+                       "Propagating,NotSpreading,Recovered\n";
+        }
+      }
+    }
+    demographics = DemographicLedger();
+    if (params.demographic_counts) {
+      demographics.reset(city.agents);
+      if (!demographicFile.is_open()) {
+        demographicFile.open("output/demographic_counts.csv");
+        if (demographicFile.is_open())
+          demographicFile << DEMOGRAPHIC_HEADER;
+      }
+    }
+    for (size_t c = 0; c < claims.size(); ++c)
+      trackClaim(c);
+
+    // Scratch buffers at their steady-state sizes
+    nextStates.assign(city.agents.size(), SEDPNRState::SUSCEPTIBLE);
+    pruneScratch.reserve(std::max(0, params.max_connections));
+    hubs = HubField();
+    if (params.hub_exposure)
+      hubs.resize(city.locations.size(), city.agents.size());
+    sampleMemory();
   }
 
   // Add a claim to the simulation
@@ -90,8 +262,12 @@ public:
     Claim c = claim;
     c.originTime = currentTime;
     claims.push_back(c);
+    claimParams.push_back(ClaimParams::compile(params, c));
+    registerClaimId(c.claimId);
 
     stateHistory[c.claimId] = std::vector<StateCounts>();
+    flowHistory[c.claimId] = std::vector<FlowMatrix>();
+    reserveHistory(c.claimId);
 
     if (initialPropagators > 0 && city.getPopulationSize() > 0) {
       std::uniform_int_distribution<size_t> dist(0,
@@ -101,19 +277,23 @@ public:
       for (int i = 0; i < initialPropagators &&
                       i < static_cast<int>(city.getPopulationSize());
            ++i) {
-        size_t agentIdx = dist(rng);
-        if (city.agents[agentIdx].isInvolved() && retries < 100) {
+        // Draws index generation order, so seeding ignores renumbering
+        size_t agentIdx = city.internalId(static_cast<int>(dist(rng)));
+        if (city.isInvolved(static_cast<int>(agentIdx)) && retries < 100) {
           retries++;
           i--;
           continue;
         }
         retries = 0;
-        city.agents[agentIdx].setState(c.claimId, SEDPNRState::PROPAGATING);
+        city.setAgentState(static_cast<int>(agentIdx), c.claimId,
+                           SEDPNRState::PROPAGATING);
         if (c.originAgentId < 0) {
-          claims.back().originAgentId = static_cast<int>(agentIdx);
+          claims.back().originAgentId =
+              city.externalId(static_cast<int>(agentIdx));
         }
       }
     }
+    trackClaim(claims.size() - 1);
   }
 
   // Add a claim with specific number of propagators per town
@@ -121,11 +301,16 @@ public:
     Claim c = claim;
     c.originTime = currentTime;
     claims.push_back(c);
+    claimParams.push_back(ClaimParams::compile(params, c));
+    registerClaimId(c.claimId);
 
     stateHistory[c.claimId] = std::vector<StateCounts>();
+    flowHistory[c.claimId] = std::vector<FlowMatrix>();
+    reserveHistory(c.claimId);
 
     std::map<int, std::vector<size_t>> townToAgents;
-    for (size_t i = 0; i < city.agents.size(); ++i) {
+    for (size_t ext = 0; ext < city.agents.size(); ++ext) {
+      size_t i = city.internalId(static_cast<int>(ext));
       townToAgents[city.agents[i].homeTownId].push_back(i);
     }
 
@@ -140,16 +325,19 @@ public:
         if (count >= propagatorsPerTown)
           break;
 
-        if (!city.agents[agentIdx].isInvolved()) {
-          city.agents[agentIdx].setState(c.claimId, SEDPNRState::PROPAGATING);
+        if (!city.isInvolved(static_cast<int>(agentIdx))) {
+          city.setAgentState(static_cast<int>(agentIdx), c.claimId,
+                             SEDPNRState::PROPAGATING);
 
           if (claims.back().originAgentId < 0) {
-            claims.back().originAgentId = static_cast<int>(agentIdx);
+            claims.back().originAgentId =
+                city.externalId(static_cast<int>(agentIdx));
           }
           count++;
         }
       }
     }
+    trackClaim(claims.size() - 1);
   }
 
   // ========================================================================
@@ -157,68 +345,324 @@ public:
   // ========================================================================
 
   void step() {
-    std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
-
-    // Process each claim
-    for (const auto &claim : claims) {
-      // Create a copy of current states to avoid order-dependent updates
-      std::map<int, SEDPNRState> newStates;
+    {
+      PROFILE_PHASE(Phase::STEP_TOTAL);
+      std::uniform_real_distribution<double> uniformDist(0.0, 1.0);
+
+      // Process each claim
+      {
+        PROFILE_PHASE(Phase::TRANSITIONS);
+        PROFILE_AGENT_STEPS(city.agents.size());
+        if (params.sparse_engine) {
+          stepTransitionsSparse(uniformDist);
+        } else {
+          stepTransitions(uniformDist);
+        }
+      }
 
-      for (auto &agent : city.agents) {
-        SEDPNRState currentState = agent.getState(claim.claimId);
-        SEDPNRState newState = currentState;
+      // Record state counts; each file output keeps its own interval
+      if (currentTime % params.output_interval == 0) {
+        PROFILE_PHASE(Phase::RECORD_COUNTS);
+        recordStateCounts();
+      }
+      if (currentTime % params.local_counts_interval == 0 && !local.empty()) {
+        PROFILE_PHASE(Phase::LOCAL_COUNTS);
+        writeLocalCounts(localFile, [](size_t) { return true; });
+      }
+      if (currentTime % params.demographic_counts_interval == 0 &&
+          !demographics.empty()) {
+        PROFILE_PHASE(Phase::DEMOGRAPHIC_COUNTS);
+        writeDemographicCounts(demographicFile);
+      }
+      if (currentTime % params.spatial_interval == 0) {
+        PROFILE_PHASE(Phase::SPATIAL_SNAPSHOT);
+        recordSpatialSnapshot();
+      }
 
-        switch (currentState) {
-        case SEDPNRState::SUSCEPTIBLE:
-          newState = processSusceptible(agent, claim, uniformDist);
-          break;
+      if (params.live_view) {
+        PROFILE_PHASE(Phase::LIVE_PUBLISH);
+        publishLive();
+      }
 
-        case SEDPNRState::EXPOSED:
-          newState = processExposed(agent, claim, uniformDist);
-          break;
+      // Prune and rewire connections for propagating agents
+      if (params.enable_connection_pruning) {
+        PROFILE_PHASE(Phase::PRUNE_REWIRE);
+        pruneAndRewireConnections();
+      }
 
-        case SEDPNRState::DOUBTFUL:
-          newState = processDoubtful(agent, claim, uniformDist);
-          break;
+      if (params.memory_sample_interval > 0 &&
+          currentTime % params.memory_sample_interval == 0) {
+        sampleMemory();
+      }
 
-        case SEDPNRState::PROPAGATING:
-          newState = processPropagating(agent, claim, uniformDist);
-          break;
+      currentTime++;
+    }
+    PROFILE_END_STEP();
+  }
 
-        case SEDPNRState::NOT_SPREADING:
-          newState = processNotSpreading(agent, claim, uniformDist);
-          break;
+  // Apply one synchronous round of SEDPNR transitions for every claim
+  void stepTransitions(std::uniform_real_distribution<double> &uniformDist) {
+    for (size_t c = 0; c < claims.size(); ++c) {
+      const Claim &claim = claims[c];
 
-        case SEDPNRState::RECOVERED:
-          // Recovered agents stay recovered
-          break;
+      // Buffer the new states to avoid order-dependent updates
+      std::vector<SEDPNRState> &newStates = nextStates;
+      newStates.resize(city.agents.size());
 
-        default:
-          break;
-        }
+      // Hub aggregates reflect the states at the start of the step
+      if (params.hub_exposure) {
+        PROFILE_PHASE(Phase::HUB_AGGREGATE);
+        hubs.accumulate(city, claim.claimId);
+      }
 
-        newStates[agent.id] = newState;
+      for (auto &agent : city.agents) {
+        newStates[agent.id] = evaluateClaim(agent, c, uniformDist);
         agent.incrementTimeInState(claim.claimId);
       }
 
+      if (params.hub_exposure)
+        hubs.clear(city);
+
       // Apply new states
       for (auto &agent : city.agents) {
-        agent.setState(claim.claimId, newStates[agent.id]);
+        applyState(agent.id, c, newStates[agent.id]);
+      }
+    }
+  }
+
+  // Apply a state change decided by the step and account for it in the
+  // ledger; returns the previous state
+  SEDPNRState applyState(int agentId, size_t c, SEDPNRState state) {
+    SEDPNRState previous =
+        city.setAgentState(agentId, claims[c].claimId, state);
+    ledger.move(c, previous, state);
+    if (!local.empty())
+      local.move(c, city.agents[agentId], previous, state);
+    if (!demographics.empty())
+      demographics.move(c, static_cast<size_t>(agentId), previous, state);
+    return previous;
+  }
+
+  // New state of one agent for one claim, from the current states. With
+  // counter_rng the draws come from the (step, claim, agent) stream
+  SEDPNRState
+  evaluateClaim(Agent &agent, size_t c,
+                std::uniform_real_distribution<double> &uniformDist) {
+    const Claim &claim = claims[c];
+    const ClaimParams &cp = claimParams[c];
+    if (params.counter_rng)
+      drawStream.seed(runSeed, currentTime, claim.claimId,
+                      city.externalId(agent.id));
+
+    SEDPNRState currentState = agent.getState(claim.claimId);
+    SEDPNRState newState = currentState;
+
+    switch (currentState) {
+    case SEDPNRState::SUSCEPTIBLE:
+      newState = processSusceptible(agent, claim, cp, uniformDist);
+      break;
+
+    case SEDPNRState::EXPOSED:
+      newState = processExposed(agent, claim, cp, uniformDist);
+      break;
+
+    case SEDPNRState::DOUBTFUL:
+      newState = processDoubtful(agent, claim, cp, uniformDist);
+      break;
+
+    case SEDPNRState::PROPAGATING:
+      newState = processPropagating(agent, claim, cp, uniformDist);
+      break;
+
+    case SEDPNRState::NOT_SPREADING:
+      newState = processNotSpreading(agent, claim, cp, uniformDist);
+      break;
+
+    case SEDPNRState::RECOVERED:
+      // Recovered agents stay recovered
+      break;
+
+    default:
+      break;
+    }
+
+    return newState;
+  }
+
+  // ========================================================================
+  // SPARSE AGENT-MAJOR ENGINE
+  // Work is limited to agents holding a live (E/D/P/N) claim state and the
+  // uninvolved neighbors of propagators, so cost follows claim activity
+  // rather than claims x population. One pass over an agent's neighbors
+  // gathers exposure, reinforcement and opposing spreaders for every claim.
+  // All claims update synchronously from the start-of-step states, and
+  // Susceptible states are never stored.
+  // ========================================================================
+  void
+  stepTransitionsSparse(std::uniform_real_distribution<double> &uniformDist) {
+    if (!activityValid)
+      rebuildActivity();
+
+    collectWork();
+
+    pending.clear();
+    for (int agentId : workList) {
+      evaluateAgentSparse(city.agents[agentId], uniformDist);
+    }
+
+    // Apply new states
+    for (const auto &change : pending) {
+      if (applyState(change.agentId, change.claim, change.state) ==
+          SEDPNRState::SUSCEPTIBLE) {
+        activity[change.claim].agents.push_back(change.agentId);
+      }
+    }
+  }
+
+  // List agents with something to do this step, in ascending ID order
+  void collectWork() {
+    workGen++;
+    workList.clear();
+    auto list = [&](int agentId) {
+      if (workStamp[agentId] != workGen) {
+        workStamp[agentId] = workGen;
+        workList.push_back(agentId);
+      }
+    };
+
+    for (size_t c = 0; c < claims.size(); ++c) {
+      ClaimActivity &act = activity[c];
+      act.propagators.clear();
+      for (int agentId : act.agents) {
+        const Agent &agent = city.agents[agentId];
+        SEDPNRState state = agent.getState(claims[c].claimId);
+        if (state == SEDPNRState::RECOVERED)
+          continue;
+        list(agentId);
+        if (state != SEDPNRState::PROPAGATING)
+          continue;
+
+        // Uninvolved neighbors of a propagator may become exposed
+        act.propagators.push_back(agentId);
+        for (int connId : agent.connections) {
+          if (!city.isInvolved(connId))
+            list(connId);
+        }
       }
     }
+    std::sort(workList.begin(), workList.end());
+  }
+
+  void evaluateAgentSparse(Agent &agent,
+                           std::uniform_real_distribution<double> &dist) {
+    if (params.counter_rng)
+      drawStream.seed(runSeed, currentTime, -1, city.externalId(agent.id));
 
-    // Record state counts
-    if (currentTime % Configuration::instance().output_interval == 0) {
-      recordStateCounts();
-      recordSpatialSnapshot();
+    // One neighbor pass for all claims
+    tallyGen++;
+    tallyTouched.clear();
+    bool seesSpreader[2] = {false, false}; // Indexed by isMisinformation
+    for (int connId : agent.connections) {
+      if (!city.isInvolved(connId))
+        continue;
+      const Agent &other = city.agents[connId];
+      int mask = -1;
+      for (auto const &entry : other.claimStates) {
+        SEDPNRState s = entry.second;
+        if (s != SEDPNRState::PROPAGATING && s != SEDPNRState::NOT_SPREADING)
+          continue;
+        int c = claimIndexById[entry.first];
+        NeighborTally &t = tally[c];
+        if (t.stamp != tallyGen) {
+          t.stamp = tallyGen;
+          t.exposure = 0.0;
+          t.reinforced = false;
+          tallyTouched.push_back(c);
+        }
+        t.reinforced = true;
+        if (s == SEDPNRState::PROPAGATING) {
+          if (mask < 0)
+            mask = agent.similarityMask(other);
+          t.exposure += params.similarityWeight[mask];
+          seesSpreader[claimParams[c].isMisinformation] = true;
+        }
+      }
     }
 
-    // Prune and rewire connections for propagating agents
-    if (Configuration::instance().enable_connection_pruning) {
-      pruneAndRewireConnections();
+    if (!city.isInvolved(agent.id)) {
+      // One state at a time: claims are tried in claim order and the first
+      // to expose the agent occupies it
+      std::sort(tallyTouched.begin(), tallyTouched.end());
+      for (int c : tallyTouched) {
+        if (susceptibleTransition(agent, claimParams[c], tally[c].exposure,
+                                  dist) == SEDPNRState::EXPOSED) {
+          pending.push_back({agent.id, c, SEDPNRState::EXPOSED});
+          break;
+        }
+      }
+      return;
     }
 
-    currentTime++;
+    for (auto const &entry : agent.claimStates) {
+      int claimId = entry.first;
+      SEDPNRState state = entry.second;
+      if (state == SEDPNRState::SUSCEPTIBLE ||
+          state == SEDPNRState::RECOVERED)
+        continue;
+
+      int c = claimIndexById[claimId];
+      const ClaimParams &cp = claimParams[c];
+      bool reinforced = tally[c].stamp == tallyGen && tally[c].reinforced;
+      bool opposing = seesSpreader[!cp.isMisinformation];
+
+      SEDPNRState newState = state;
+      switch (state) {
+      case SEDPNRState::EXPOSED:
+        newState = exposedTransition(agent, claimId, reinforced, cp, dist);
+        break;
+      case SEDPNRState::DOUBTFUL:
+        newState = doubtfulTransition(agent, claimId, opposing, reinforced, cp,
+                                      dist);
+        break;
+      case SEDPNRState::PROPAGATING:
+        newState = propagatingTransition(agent, claimId, opposing, cp, dist);
+        break;
+      case SEDPNRState::NOT_SPREADING:
+        newState = notSpreadingTransition(opposing, cp, dist);
+        break;
+      default:
+        break;
+      }
+
+      if (newState != state) {
+        pending.push_back({agent.id, c, newState});
+      } else {
+        agent.incrementTimeInState(claimId);
+      }
+    }
+  }
+
+  // Rebuild the per-claim activity lists and size the engine's scratch
+  void rebuildActivity() {
+    activity.clear();
+    activity.reserve(claims.size());
+    for (size_t c = 0; c < claims.size(); ++c) {
+      activity.emplace_back(city.memoryResource());
+    }
+    for (const auto &agent : city.agents) {
+      for (auto const &entry : agent.claimStates) {
+        if (entry.second != SEDPNRState::SUSCEPTIBLE) {
+          activity[claimIndexById[entry.first]].agents.push_back(agent.id);
+        }
+      }
+    }
+
+    tally.assign(claims.size(), NeighborTally());
+    tallyTouched.reserve(claims.size());
+    workStamp.assign(city.agents.size(), 0);
+    workList.reserve(city.agents.size());
+    pending.reserve(city.agents.size());
+    activityValid = true;
   }
 
   // ========================================================================
@@ -226,7 +670,10 @@ public:
   // Propagating agents cut ties with unresponsive connections
   // ========================================================================
   void pruneAndRewireConnections() {
-    auto &cfg = Configuration::instance();
+    if (params.sparse_engine && activityValid) {
+      pruneSparse();
+      return;
+    }
 
     for (auto &agent : city.agents) {
       // Only propagating agents prune connections
@@ -244,38 +691,73 @@ public:
       if (!isPropagating)
         continue;
 
-      // Check each connection
-      std::vector<int> toPrune;
-      for (int connId : agent.connections) {
-        Agent &conn = city.getAgent(connId);
-        SEDPNRState connState = conn.getState(propagatingClaimId);
-
-        if (connState == SEDPNRState::SUSCEPTIBLE) {
-          // Connection is still susceptible - increment tenure
-          agent.incrementConnectionTenure(connId);
+      pruneAgent(agent, propagatingClaimId);
+    }
+  }
 
-          if (agent.getConnectionTenure(connId) >= cfg.connection_patience) {
-            toPrune.push_back(connId);
-          }
-        } else {
-          // Connection has responded (any state but Susceptible) - reset tenure
-          agent.connectionTenure[connId] = 0;
+  // Same pass driven by the activity lists: propagators in ascending ID
+  // order, each pruning for its first propagating claim in claim order
+  void pruneSparse() {
+    workGen++;
+    workList.clear();
+    for (size_t c = 0; c < claims.size(); ++c) {
+      for (int agentId : activity[c].agents) {
+        if (workStamp[agentId] != workGen &&
+            city.agents[agentId].getState(claims[c].claimId) ==
+                SEDPNRState::PROPAGATING) {
+          workStamp[agentId] = workGen;
+          workList.push_back(agentId);
         }
       }
+    }
+    std::sort(workList.begin(), workList.end());
+
+    for (int agentId : workList) {
+      Agent &agent = city.agents[agentId];
+      int first = -1;
+      for (auto const &entry : agent.claimStates) {
+        int c = claimIndexById[entry.first];
+        if (entry.second == SEDPNRState::PROPAGATING &&
+            (first < 0 || c < first))
+          first = c;
+      }
+      pruneAgent(agent, claims[first].claimId);
+    }
+  }
+
+  void pruneAgent(Agent &agent, int propagatingClaimId) {
+    // Check each connection
+    std::vector<int> &toPrune = pruneScratch;
+    toPrune.clear();
+    for (int connId : agent.connections) {
+      Agent &conn = city.getAgent(connId);
+      SEDPNRState connState = conn.getState(propagatingClaimId);
 
-      // Prune and rewire
-      for (int connId : toPrune) {
-        // Remove bidirectional connection
-        Agent &conn = city.getAgent(connId);
-        agent.removeConnection(connId);
-        conn.removeConnection(agent.id);
+      if (connState == SEDPNRState::SUSCEPTIBLE) {
+        // Connection is still susceptible - increment tenure
+        agent.incrementConnectionTenure(connId);
 
-        // Find new random connection
-        int newConnId = city.findRandomNewConnection(agent.id, connId);
-        if (newConnId >= 0) {
-          agent.addConnection(newConnId);
-          city.getAgent(newConnId).addConnection(agent.id);
+        if (agent.getConnectionTenure(connId) >= params.connection_patience) {
+          toPrune.push_back(connId);
         }
+      } else {
+        // Connection has responded (any state but Susceptible) - reset tenure
+        agent.connectionTenure[connId] = 0;
+      }
+    }
+
+    // Prune and rewire
+    for (int connId : toPrune) {
+      // Remove bidirectional connection
+      Agent &conn = city.getAgent(connId);
+      agent.removeConnection(connId);
+      conn.removeConnection(agent.id);
+
+      // Find new random connection
+      int newConnId = city.findRandomNewConnection(agent.id, connId);
+      if (newConnId >= 0) {
+        agent.addConnection(newConnId);
+        city.getAgent(newConnId).addConnection(agent.id);
       }
     }
   }
@@ -283,24 +765,350 @@ public:
   void recordSpatialSnapshot() {
     if (!spatialFile.is_open())
       return;
+    startArrow();
+
+    bool everyAgent = params.full_spatial_snapshot || currentTime == 0;
+    if (sampler.active()) {
+      recordSpatialSample(everyAgent);
+    } else if (params.sparse_engine && activityValid && !everyAgent) {
+      recordSpatialSnapshotSparse();
+    } else {
+      for (const auto &claim : claims) {
+        for (const auto &agent : city.agents) {
+          SEDPNRState state = agent.getState(claim.claimId);
+          // Record if not susceptible OR if configured to record full
+          // snapshot
+          if (everyAgent || state != SEDPNRState::SUSCEPTIBLE) {
+            writeSpatialRow(agent, claim, state);
+          }
+        }
+      }
+    }
+    if (spatialArrow.isOpen())
+      spatialArrow.writeBatch();
+  }
 
-    for (const auto &claim : claims) {
-      for (const auto &agent : city.agents) {
-        SEDPNRState state = agent.getState(claim.claimId);
-        // Record if not susceptible OR if configured to record full snapshot
-        if (Configuration::instance().full_spatial_snapshot ||
-            state != SEDPNRState::SUSCEPTIBLE || currentTime == 0) {
-          spatialFile << currentTime << "," << agent.id << ","
-                      << agent.homeTownId << "," << agent.schoolLocationId
-                      << "," << agent.religiousLocationId << ","
-                      << agent.workplaceLocationId << "," << claim.claimId
-                      << "," << static_cast<int>(state) << ","
-                      << (claim.isMisinformation ? 1 : 0) << ","
-                      << static_cast<int>(agent.ethnicity) << ","
-                      << static_cast<int>(agent.denomination) << "\n";
+  // Non-Susceptible rows only, taken from the activity lists (sorted into
+  // the same ascending agent order as the full scan)
+  void recordSpatialSnapshotSparse() {
+    for (size_t c = 0; c < claims.size(); ++c) {
+      workList.assign(activity[c].agents.begin(), activity[c].agents.end());
+      std::sort(workList.begin(), workList.end());
+      for (int agentId : workList) {
+        const Agent &agent = city.agents[agentId];
+        writeSpatialRow(agent, claims[c], agent.getState(claims[c].claimId));
+      }
+    }
+  }
+
+  // Panel rows plus this record's reservoir, drawn from the rows the full
+  // or sparse snapshot would have written
+  void recordSpatialSample(bool everyAgent) {
+    auto externalId = [&](int id) { return city.externalId(id); };
+    for (size_t c = 0; c < claims.size(); ++c) {
+      int claimId = claims[c].claimId;
+      auto candidates = [&](auto offer) {
+        if (params.sparse_engine && activityValid && !everyAgent) {
+          for (int agentId : activity[c].agents)
+            offer(agentId);
+          return;
         }
+        for (const auto &agent : city.agents) {
+          if (everyAgent ||
+              agent.getState(claimId) != SEDPNRState::SUSCEPTIBLE)
+            offer(agent.id);
+        }
+      };
+      sampler.select(currentTime, sampler.panelAgents(), candidates,
+                     externalId, workList);
+      for (int agentId : workList) {
+        const Agent &agent = city.agents[agentId];
+        writeSpatialRow(agent, claims[c], agent.getState(claimId));
+      }
+    }
+  }
+
+  // Copy this step's states into the live-view ring, creating it on first
+  // use (and again if claims were added since)
+  void publishLive() {
+    if (liveFailed)
+      return;
+    size_t n = city.agents.size();
+    if (live.claimCount() != claims.size()) {
+      std::vector<LiveClaim> claimRows;
+      for (const auto &claim : claims)
+        claimRows.push_back({claim.claimId, claim.isMisinformation ? 1 : 0});
+      std::vector<LiveAgent> agentRows(n);
+      for (const auto &agent : city.agents)
+        agentRows[city.externalId(agent.id)] = {
+            agent.homeTownId,          agent.schoolLocationId,
+            agent.religiousLocationId, agent.workplaceLocationId,
+            static_cast<int32_t>(agent.ethnicity),
+            static_cast<int32_t>(agent.denomination)};
+      if (!live.open(claimRows, agentRows)) {
+        std::cerr << "Warning: could not create shared memory "
+                  << LIVE_VIEW_NAME << "; live view disabled" << std::endl;
+        liveFailed = true;
+        return;
       }
     }
+    int8_t *states = live.beginStep(currentTime);
+    for (size_t c = 0; c < claims.size(); ++c) {
+      int8_t *row = states + c * n;
+      for (const auto &agent : city.agents)
+        row[city.externalId(agent.id)] =
+            static_cast<int8_t>(agent.getState(claims[c].claimId));
+    }
+    live.commitStep();
+  }
+
+  static constexpr const char *SPATIAL_HEADER =
+      "Time,AgentId,TownId,SchoolId,ReligiousId,WorkplaceId,ClaimId,"
+      "State,IsMisinformation,Ethnicity,Denomination\n";
+
+  void writeSpatialRow(const Agent &agent, const Claim &claim,
+                       SEDPNRState state) {
+    // Formatted into one buffer so the index learns the row's length
+    const int fields[] = {currentTime,
+                          city.externalId(agent.id),
+                          agent.homeTownId,
+                          agent.schoolLocationId,
+                          agent.religiousLocationId,
+                          agent.workplaceLocationId,
+                          claim.claimId,
+                          static_cast<int>(state),
+                          claim.isMisinformation ? 1 : 0,
+                          static_cast<int>(agent.ethnicity),
+                          static_cast<int>(agent.denomination)};
+    char row[160];
+    char *p = row;
+    for (int value : fields) {
+      p = std::to_chars(p, row + sizeof(row), value).ptr;
+      *p++ = ',';
+    }
+    p[-1] = '\n';
+    spatialFile.write(row, p - row);
+    if (spatialIndex.isActive())
+      spatialIndex.add(fields[0], fields[1], claim.claimId,
+                       claim.isMisinformation,
+                       {fields[2], fields[3], fields[4], fields[5], fields[9],
+                        fields[10]},
+                       fields[7], static_cast<size_t>(p - row));
+    if (spatialArrow.isOpen())
+      appendSpatialArrow(fields, claimIndexById[claim.claimId]);
+  }
+
+  // ========================================================================
+  // ARROW OUTPUT
+  // ========================================================================
+
+  // Spatial rows as in the CSV, plus the claim name after ClaimId. The
+  // city is fixed by then, so agent and location IDs take int16 columns
+  // whenever they fit
+  std::vector<ArrowField> spatialArrowSchema() const {
+    auto idType = [](size_t count) {
+      return count <= INT16_MAX ? ArrowType::INT16 : ArrowType::INT32;
+    };
+    ArrowType agentId = idType(city.agents.size());
+    ArrowType locationId = idType(city.locations.size());
+    return {{"Time", ArrowType::INT32},
+            {"AgentId", agentId},
+            {"TownId", ArrowType::INT16},
+            {"SchoolId", locationId},
+            {"ReligiousId", locationId},
+            {"WorkplaceId", locationId},
+            {"ClaimId", ArrowType::INT32},
+            {"ClaimName", ArrowType::DICT_UTF8},
+            {"State", ArrowType::INT8},
+            {"IsMisinformation", ArrowType::BOOL},
+            {"Ethnicity", ArrowType::INT8},
+            {"Denomination", ArrowType::INT8}};
+  }
+
+  static std::vector<ArrowField> resultsArrowSchema() {
+    return {{"Time", ArrowType::INT32},
+            {"ClaimId", ArrowType::INT32},
+            {"ClaimName", ArrowType::DICT_UTF8},
+            {"IsMisinformation", ArrowType::BOOL},
+            {"Susceptible", ArrowType::INT32},
+            {"Exposed", ArrowType::INT32},
+            {"Doubtful", ArrowType::INT32},
+            {"Propagating", ArrowType::INT32},
+            {"NotSpreading", ArrowType::INT32},
+            {"Recovered", ArrowType::INT32}};
+  }
+
+  static constexpr size_t SPATIAL_ARROW_NAME = 7; // ClaimName columns
+  static constexpr size_t RESULTS_ARROW_NAME = 2;
+
+  // Open the Arrow outputs on first use and add the names of claims added
+  // since to their dictionaries (dictionary index = claim index); false if
+  // arrow_output is off
+  bool startArrow() {
+    if (!params.arrow_output)
+      return false;
+    if (!arrowStarted) {
+      arrowStarted = true;
+      // Size the writers for the largest batch (every agent of every
+      // claim, or every sampled one) and every record of the run, so that
+      // steady-state records do not allocate
+      size_t spatialRows =
+          sampler.active() ? sampler.maxRows() : city.agents.size();
+      size_t steps = static_cast<size_t>(std::max(0, params.timesteps));
+      if (spatialFile.is_open() &&
+          !spatialArrow.open("output/spatial_data.arrow", spatialArrowSchema(),
+                             spatialRows * claims.size(),
+                             steps / params.spatial_interval + 1))
+        std::cerr << "Error: Could not open output/spatial_data.arrow"
+                  << std::endl;
+      if (!resultsArrow.open("output/simulation_results.arrow",
+                             resultsArrowSchema(), claims.size(),
+                             steps / params.output_interval + 1))
+        std::cerr << "Error: Could not open output/simulation_results.arrow"
+                  << std::endl;
+    }
+    if (arrowClaims < claims.size()) {
+      if (claims.size() > INT16_MAX) {
+        std::cerr << "Warning: more than " << INT16_MAX
+                  << " claims; Arrow output stopped" << std::endl;
+        spatialArrow.close();
+        resultsArrow.close();
+        params.arrow_output = false;
+        return false;
+      }
+      std::vector<std::string> names;
+      for (size_t c = arrowClaims; c < claims.size(); ++c)
+        names.push_back(claims[c].name);
+      if (spatialArrow.isOpen())
+        spatialArrow.addDictionaryValues(SPATIAL_ARROW_NAME, names);
+      if (resultsArrow.isOpen())
+        resultsArrow.addDictionaryValues(RESULTS_ARROW_NAME, names);
+      arrowClaims = claims.size();
+    }
+    return true;
+  }
+
+  // row holds the eleven CSV columns of a spatial row
+  void appendSpatialArrow(const int *row, size_t claim) {
+    for (size_t k = 0; k < SPATIAL_ARROW_NAME; ++k)
+      spatialArrow.append(k, row[k]);
+    spatialArrow.append(SPATIAL_ARROW_NAME, claim);
+    for (size_t k = SPATIAL_ARROW_NAME; k < 11; ++k)
+      spatialArrow.append(k + 1, row[k]);
+  }
+
+  // One batch with each claim's record `back` records before its latest;
+  // Time is the claim's record index, as in outputResults()
+  void writeResultsArrow(size_t back) {
+    if (!startArrow() || !resultsArrow.isOpen())
+      return;
+    for (size_t c = 0; c < claims.size(); ++c) {
+      const auto &history = stateHistory[claims[c].claimId];
+      if (history.size() <= back)
+        continue;
+      size_t t = history.size() - 1 - back;
+      const StateCounts &n = history[t];
+      const int row[] = {static_cast<int>(t),
+                         claims[c].claimId,
+                         static_cast<int>(c),
+                         claims[c].isMisinformation ? 1 : 0,
+                         n.susceptible,
+                         n.exposed,
+                         n.doubtful,
+                         n.propagating,
+                         n.notSpreading,
+                         n.recovered};
+      for (size_t k = 0; k < std::size(row); ++k)
+        resultsArrow.append(k, row[k]);
+    }
+    resultsArrow.writeBatch();
+  }
+
+  // Write the Arrow footers (arrow_output=true)
+  void closeArrowOutputs() {
+    if (spatialArrow.isOpen() && spatialArrow.close())
+      std::cout << "Snapshots written to: output/spatial_data.arrow"
+                << std::endl;
+    if (resultsArrow.isOpen() && resultsArrow.close())
+      std::cout << "Results written to: output/simulation_results.arrow"
+                << std::endl;
+  }
+
+  // Save the spatial index next to the dump (spatial_index=true)
+  void outputSpatialIndex(
+      const std::string &filename = "output/spatial_data.csv.idx") {
+    if (!spatialIndex.isActive())
+      return;
+    spatialFile.flush();
+    if (!spatialIndex.save(filename))
+      std::cerr << "Error: Could not write spatial index: " << filename
+                << std::endl;
+  }
+
+  // Write the local units that changed since the last record (every unit
+  // at a claim's first record), filtered by keep(unit)
+  template <typename Keep> void writeLocalCounts(std::ostream &out, Keep keep) {
+    size_t units = local.units();
+    for (size_t slot : local.takeDirty()) {
+      size_t c = slot / units, unit = slot % units;
+      if (!out || !keep(unit))
+        continue;
+      const StateCounts &n = local.at(c, unit);
+      out << currentTime << "," << claims[c].claimId << ","
+          << localLevel(unit) << "," << localId(unit) << "," << n.susceptible
+          << "," << n.exposed << "," << n.doubtful << "," << n.propagating
+          << "," << n.notSpreading << "," << n.recovered << "\n";
+    }
+  }
+
+  static constexpr const char *DEMOGRAPHIC_HEADER =
+      "Time,ClaimId,Ethnicity,Denomination,AgeGroup,Susceptible,Exposed,"
+      "Doubtful,Propagating,NotSpreading,Recovered,EverInfected\n";
+
+  // Write the populated demographic cells that changed since the last
+  // record (every populated cell at a claim's first record); cells are
+  // listed ethnicity-major, as in demographicCell()
+  void writeDemographicCounts(std::ostream &out) {
+    for (size_t slot : demographics.takeDirty()) {
+      size_t c = slot / NUM_DEMOGRAPHIC_CELLS;
+      int cell = static_cast<int>(slot % NUM_DEMOGRAPHIC_CELLS);
+      const StateCounts &n = demographics.at(c, cell);
+      if (!out || n.total() == 0)
+        continue;
+      int age = cell % NUM_AGE_CELLS;
+      int denom = (cell / NUM_AGE_CELLS) % NUM_DENOMINATION_CELLS;
+      int eth = cell / (NUM_AGE_CELLS * NUM_DENOMINATION_CELLS);
+      out << currentTime << "," << claims[c].claimId << "," << eth << ","
+          << denom << "," << age << "," << n.susceptible << "," << n.exposed
+          << "," << n.doubtful << "," << n.propagating << ","
+          << n.notSpreading << "," << n.recovered << ","
+          << demographics.everInfected(c, cell) << "\n";
+    }
+  }
+
+  // Town ID or dense location ID of a local unit
+  int localId(size_t unit) const {
+    size_t towns = local.townCount();
+    return static_cast<int>(unit < towns ? unit : unit - towns);
+  }
+
+  // Home town of a local unit
+  int localTown(size_t unit) const {
+    return unit < local.townCount() ? localId(unit)
+                                    : city.locations.get(localId(unit)).townId;
+  }
+
+  const char *localLevel(size_t unit) const {
+    if (unit < local.townCount())
+      return "town";
+    switch (city.locations.get(localId(unit)).type) {
+    case LocationType::SCHOOL:
+      return "school";
+    case LocationType::RELIGIOUS_ESTABLISHMENT:
+      return "religious";
+    default:
+      return "workplace";
+    }
   }
 
   // ========================================================================
@@ -354,6 +1162,41 @@ public:
     std::cout << "Results written to: " << filename << std::endl;
   }
 
+  // One row per nonzero flow: agents that moved From -> To for a claim
+  // since the previous record. Time is the record index, as in
+  // outputResults()
+  void outputFlows(const std::string &filename = "output/flows.csv") {
+    std::ofstream file(filename);
+
+    if (!file.is_open()) {
+      std::cerr << "Error: Could not open flows file: " << filename
+                << std::endl;
+      return;
+    }
+
+    file << "Time,ClaimId,From,To,Count\n";
+    for (const auto &claim : claims) {
+      const auto &history = flowHistory[claim.claimId];
+
+      for (size_t t = 0; t < history.size(); ++t) {
+        for (int from = 0; from < NUM_FLOW_STATES; ++from) {
+          for (int to = 0; to < NUM_FLOW_STATES; ++to) {
+            int count = history[t][from * NUM_FLOW_STATES + to];
+            if (count == 0)
+              continue;
+            file << t << "," << claim.claimId << ","
+                 << stateToChar(static_cast<SEDPNRState>(from)) << ","
+                 << stateToChar(static_cast<SEDPNRState>(to)) << "," << count
+                 << "\n";
+          }
+        }
+      }
+    }
+
+    file.close();
+    std::cout << "Flows written to: " << filename << std::endl;
+  }
+
   // Output summary statistics
   void outputSummary() {
     std::cout << "\n=== Simulation Summary ===" << std::endl;
@@ -381,6 +1224,94 @@ public:
     }
   }
 
+  // ========================================================================
+  // MEMORY ACCOUNTING
+  // ========================================================================
+
+  // Re-measure every structure and update the per-structure peaks
+  void sampleMemory() {
+    using namespace memsize;
+    memory.beginSample();
+    city.accountMemory(memory);
+
+    size_t namePayload = 0, nameLive = 0;
+    for (const auto &claim : claims) {
+      namePayload += payload(claim.name);
+      nameLive += heap(claim.name);
+    }
+    memory.add("Simulation::claims", claims.size(), payload(claims) + namePayload,
+           heap(claims) + nameLive);
+
+    size_t rows = 0, historyPayload = 0, historyLive = 0;
+    for (const auto &entry : stateHistory) {
+      rows += entry.second.size();
+      historyPayload += payload(entry.second);
+      historyLive += heap(entry.second);
+    }
+    historyLive +=
+        stateHistory.size() *
+        chunk(RB_NODE_HEADER + sizeof(decltype(stateHistory)::value_type));
+    memory.add("Simulation::stateHistory", rows, historyPayload, historyLive);
+
+    rows = 0;
+    historyPayload = 0;
+    historyLive = 0;
+    for (const auto &entry : flowHistory) {
+      rows += entry.second.size();
+      historyPayload += payload(entry.second);
+      historyLive += heap(entry.second);
+    }
+    historyLive +=
+        flowHistory.size() *
+        chunk(RB_NODE_HEADER + sizeof(decltype(flowHistory)::value_type));
+    memory.add("Simulation::flowHistory", rows, historyPayload, historyLive);
+    if (!activity.empty()) {
+      size_t listed = 0, activityPayload = 0, activityLive = 0;
+      for (const auto &act : activity) {
+        listed += act.agents.size();
+        activityPayload += payload(act.agents) + payload(act.propagators);
+        activityLive += heap(act.agents) + heap(act.propagators);
+      }
+      memory.add("Simulation::claimActivity", listed,
+                 payload(activity) + activityPayload,
+                 heap(activity) + activityLive);
+    }
+    if (!local.empty()) {
+      memory.add("Simulation::localCounts", local.units() * claims.size(),
+                 local.units() * claims.size() * sizeof(StateCounts),
+                 local.bytes());
+    }
+    if (!demographics.empty()) {
+      size_t cells = demographics.claimCount() * NUM_DEMOGRAPHIC_CELLS;
+      memory.add("Simulation::demographicCounts", cells,
+                 cells * (sizeof(StateCounts) + sizeof(int)),
+                 demographics.bytes());
+    }
+    if (!hubs.empty()) {
+      memory.add("Simulation::hubAggregates", hubs.aggregates().size(),
+                 hubs.payloadBytes(),
+                 heap(hubs.aggregates()) + heap(hubs.propagatorList()));
+    }
+
+    // std::filebuf allocates one BUFSIZ buffer while the file is open
+    size_t spatialBuffer = spatialFile.is_open() ? chunk(BUFSIZ) : 0;
+    memory.add("Simulation::spatialFile", spatialFile.is_open() ? 1 : 0,
+           spatialBuffer, spatialBuffer);
+    if (spatialIndex.isActive())
+      memory.add("Simulation::spatialIndex", 1, spatialIndex.bytes(),
+                 spatialIndex.bytes());
+    if (sampler.active())
+      memory.add("Simulation::sampler", 1, sampler.bytes(), sampler.bytes());
+    memory.endSample();
+  }
+
+  const MemoryReport &memoryReport() const { return memory; }
+
+  void printMemoryReport(const std::string &title) {
+    sampleMemory();
+    memory.print(title);
+  }
+
   // Get latest state counts for a claim
   StateCounts getLatestStateCounts(int claimId) const {
     auto it = stateHistory.find(claimId);
@@ -393,37 +1324,60 @@ public:
 private:
   // ========================================================================
   // STATE TRANSITION PROCESSORS
+  // Each processor gathers what it needs from the agent's neighbors and
+  // hands the decision to a transition rule; the sparse engine gathers the
+  // same facts for every claim in one neighbor pass and reuses the rules
   // ========================================================================
 
+  // Uniform draw for a transition rule
+  double draw(std::uniform_real_distribution<double> &dist) {
+    return params.counter_rng ? dist(drawStream) : dist(rng);
+  }
+
+  // Stance of a claim by ID (false for unknown IDs)
+  bool claimIsMisinformation(int claimId) const {
+    if (claimId < 0 || claimId >= static_cast<int>(claimIndexById.size()))
+      return false;
+    int c = claimIndexById[claimId];
+    return c >= 0 && claimParams[c].isMisinformation;
+  }
+
   bool hasOpposingSpreader(const Agent &agent, const Claim &claim) {
     for (int connId : agent.connections) {
       const Agent &neighbor = city.getAgent(connId);
       for (auto const &entry : neighbor.claimStates) {
         int neighborCid = entry.first;
         SEDPNRState neighborState = entry.second;
-        if (neighborState == SEDPNRState::PROPAGATING) {
-          // Truth is ID 0, Misinfo is IDs > 0
-          bool neighborIsMisinfo = (neighborCid != 0);
-          if (claim.isMisinformation != neighborIsMisinfo) {
-            return true;
-          }
+        if (neighborState == SEDPNRState::PROPAGATING &&
+            claimIsMisinformation(neighborCid) != claim.isMisinformation) {
+          return true;
         }
       }
     }
     return false;
   }
 
+  // Does any neighbor hold the claim as adopted (P or N)?
+  bool hasReinforcement(const Agent &agent, const Claim &claim) {
+    for (int connId : agent.connections) {
+      SEDPNRState s = city.getAgent(connId).getState(claim.claimId);
+      if (s == SEDPNRState::PROPAGATING || s == SEDPNRState::NOT_SPREADING) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   // Process susceptible agent (S -> E)
   SEDPNRState processSusceptible(Agent &agent, const Claim &claim,
+                                 const ClaimParams &cp,
                                  std::uniform_real_distribution<double> &dist) {
     // If agent is already occupied with another claim (one state at a time
     // rule)
-    if (agent.isInvolved()) {
+    if (city.isInvolved(agent.id)) {
       return SEDPNRState::SUSCEPTIBLE;
     }
 
-    auto &cfg = Configuration::instance();
-
     // Calculate effective exposure from propagators, weighted by similarity
     double effectiveExposure = 0.0;
     for (int connId : agent.connections) {
@@ -431,32 +1385,35 @@ private:
       if (other.getState(claim.claimId) == SEDPNRState::PROPAGATING) {
         // Multiplier based on similarity (homophily)
         // Strong Homophily = High Confirmation Bias (Identity-based trust)
-        // We use power function to disproportionately weight similar agents
-        double similarity = agent.calculateSimilarity(other);
-        effectiveExposure += std::pow(similarity, cfg.homophily_strength);
+        // pow(similarity, homophily_strength) is precomputed per mask
+        effectiveExposure +=
+            params.similarityWeight[agent.similarityMask(other)];
       }
     }
 
-    if (effectiveExposure > 0.0) {
-      // Calculate exposure probability
-      double baseProb = cfg.prob_s_to_e;
+    // Mean-field term from the agent's school, religious site and workplace
+    if (params.hub_exposure)
+      effectiveExposure += hubs.exposure(city, agent, params);
 
+    return susceptibleTransition(agent, cp, effectiveExposure, dist);
+  }
+
+  SEDPNRState
+  susceptibleTransition(const Agent &agent, const ClaimParams &cp,
+                        double effectiveExposure,
+                        std::uniform_real_distribution<double> &dist) {
+    if (effectiveExposure > 0.0) {
       // If misinformation, it spreads FASTER (more effective
       // exposure/frequency), not necessarily because people are more gullible
-      // (higher base prob). So we apply the multiplier to the EXPOSURE count.
-      if (claim.isMisinformation) {
-        effectiveExposure *= cfg.misinfo_multiplier;
-      }
-
-      // Modify by interactions (weighted by similarity)
-      // We use effectiveExposure as the exponent, treating "1.0 similarity" as
-      // one standard contact
-      double prob = 1.0 - std::pow(1.0 - baseProb, effectiveExposure);
+      // (higher base prob). The misinfo multiplier is folded into
+      // exposureLogKeep, so 1 - (1 - p)^(m * E) becomes 1 - exp(E * m *
+      // log1p(-p)), treating "1.0 similarity" as one standard contact
+      double prob = 1.0 - std::exp(effectiveExposure * cp.exposureLogKeep);
 
       // Modify by claim passing frequency
-      prob *= agent.getClaimPassingFrequency();
+      prob *= city.passingFrequency[agent.id];
 
-      if (dist(rng) < prob) {
+      if (draw(dist) < prob) {
         return SEDPNRState::EXPOSED;
       }
     }
@@ -466,22 +1423,19 @@ private:
 
   // Process exposed agent (E -> D)
   SEDPNRState processExposed(Agent &agent, const Claim &claim,
+                             const ClaimParams &cp,
                              std::uniform_real_distribution<double> &dist) {
-    auto &cfg = Configuration::instance();
+    return exposedTransition(agent, claim.claimId,
+                             hasReinforcement(agent, claim), cp, dist);
+  }
 
+  SEDPNRState exposedTransition(const Agent &agent, int claimId,
+                                bool reinforced, const ClaimParams &cp,
+                                std::uniform_real_distribution<double> &dist) {
     // REQUIREMENT: Must have connections to someone who has adopted (P or N)
     // to progress to Doubtful (social reinforcement)
-    bool hasReinforcement = false;
-    for (int connId : agent.connections) {
-      SEDPNRState s = city.getAgent(connId).getState(claim.claimId);
-      if (s == SEDPNRState::PROPAGATING || s == SEDPNRState::NOT_SPREADING) {
-        hasReinforcement = true;
-        break;
-      }
-    }
-
-    if (hasReinforcement && agent.getTimeInState(claim.claimId) >= 0) {
-      if (dist(rng) < cfg.prob_e_to_d) {
+    if (reinforced && agent.getTimeInState(claimId) >= 0) {
+      if (draw(dist) < cp.probEtoD) {
         return SEDPNRState::DOUBTFUL;
       }
     }
@@ -491,52 +1445,46 @@ private:
 
   // Process doubtful agent (D -> P, N, or R)
   SEDPNRState processDoubtful(Agent &agent, const Claim &claim,
+                              const ClaimParams &cp,
                               std::uniform_real_distribution<double> &dist) {
     // If I see the opposite view being spread, I commit to defending my view
     if (hasOpposingSpreader(agent, claim)) {
       return SEDPNRState::PROPAGATING;
     }
+    return doubtfulTransition(agent, claim.claimId, false,
+                              hasReinforcement(agent, claim), cp, dist);
+  }
 
-    auto &cfg = Configuration::instance();
-
-    if (agent.getTimeInState(claim.claimId) >= 0) {
-      // Calculate adoption threshold based on claim type and agent credibility
-      double threshold =
-          claim.isMisinformation ? cfg.misinfo_threshold : cfg.truth_threshold;
+  SEDPNRState doubtfulTransition(const Agent &agent, int claimId,
+                                 bool opposingSpreader, bool reinforced,
+                                 const ClaimParams &cp,
+                                 std::uniform_real_distribution<double> &dist) {
+    if (opposingSpreader) {
+      return SEDPNRState::PROPAGATING;
+    }
 
+    if (agent.getTimeInState(claimId) >= 0) {
       // Credibility affects belief probability (Multiplier based on age)
       // Range: ~0.5 to ~1.5 based on optimal age proximity
-      double beliefMultiplier = 0.5 + agent.credibilityValue;
+      double beliefMultiplier = city.beliefMultiplier[agent.id];
 
-      double roll = dist(rng);
+      double roll = draw(dist);
 
-      // Adjusted probabilities
-      double probReject = cfg.prob_d_to_r;
-      double probPropagate =
-          (cfg.prob_d_to_p * (1.0 - threshold)) * beliefMultiplier;
-      double probNotSpread = cfg.prob_d_to_n;
+      // Adjusted probabilities (claim threshold already folded in; truth
+      // claims carry a zero rejection probability)
+      double probReject = cp.probReject;
+      double probPropagate = cp.probPropagate * beliefMultiplier;
+      double probNotSpread = cp.probNotSpread;
 
       // REQUIREMENT: Validating social proof for adoption (P or N)
       // If no neighbors are P or N, you can't adopt, but you CAN reject.
-      bool hasReinforcement = false;
-      for (int connId : agent.connections) {
-        SEDPNRState s = city.getAgent(connId).getState(claim.claimId);
-        if (s == SEDPNRState::PROPAGATING || s == SEDPNRState::NOT_SPREADING) {
-          hasReinforcement = true;
-          break;
-        }
-      }
-
-      // Truth claims should not be rejected/recovered from
-      double actualProbReject = claim.isMisinformation ? probReject : 0.0;
-
-      if (roll < actualProbReject) {
+      if (roll < probReject) {
         return SEDPNRState::RECOVERED;
-      } else if (hasReinforcement) {
+      } else if (reinforced) {
         // Only allow adoption if reinforced
-        if (roll < actualProbReject + probPropagate) {
+        if (roll < probReject + probPropagate) {
           return SEDPNRState::PROPAGATING;
-        } else if (roll < actualProbReject + probPropagate + probNotSpread) {
+        } else if (roll < probReject + probPropagate + probNotSpread) {
           return SEDPNRState::NOT_SPREADING;
         }
       }
@@ -547,22 +1495,28 @@ private:
 
   // Process propagating agent (P -> N or R)
   SEDPNRState processPropagating(Agent &agent, const Claim &claim,
+                                 const ClaimParams &cp,
                                  std::uniform_real_distribution<double> &dist) {
+    return propagatingTransition(agent, claim.claimId,
+                                 hasOpposingSpreader(agent, claim), cp, dist);
+  }
+
+  SEDPNRState
+  propagatingTransition(const Agent &agent, int claimId, bool opposingSpreader,
+                        const ClaimParams &cp,
+                        std::uniform_real_distribution<double> &dist) {
     // If I see the opposite view being spread, I stay active to defend my view
-    if (hasOpposingSpreader(agent, claim)) {
+    if (opposingSpreader) {
       return SEDPNRState::PROPAGATING;
     }
 
-    auto &cfg = Configuration::instance();
-    if (agent.getTimeInState(claim.claimId) >= 0) {
-      double roll = dist(rng);
-
-      // Truth claims should not be recovered from
-      double probPtoR = claim.isMisinformation ? cfg.prob_p_to_r : 0.0;
+    if (agent.getTimeInState(claimId) >= 0) {
+      double roll = draw(dist);
 
-      if (roll < probPtoR) {
+      // Truth claims should not be recovered from (probPtoR is zero)
+      if (roll < cp.probPtoR) {
         return SEDPNRState::RECOVERED;
-      } else if (roll < probPtoR + cfg.prob_p_to_n) {
+      } else if (roll < cp.probPtoR + cp.probPtoN) {
         return SEDPNRState::NOT_SPREADING;
       }
     }
@@ -572,19 +1526,21 @@ private:
 
   // Process not-spreading agent (N -> R)
   SEDPNRState
-  processNotSpreading(Agent &agent, const Claim &claim,
+  processNotSpreading(Agent &agent, const Claim &claim, const ClaimParams &cp,
                       std::uniform_real_distribution<double> &dist) {
-    auto &cfg = Configuration::instance();
+    return notSpreadingTransition(hasOpposingSpreader(agent, claim), cp, dist);
+  }
 
+  SEDPNRState
+  notSpreadingTransition(bool opposingSpreader, const ClaimParams &cp,
+                         std::uniform_real_distribution<double> &dist) {
     // Reactivate if I see the opposite view being spread
-    if (hasOpposingSpreader(agent, claim)) {
+    if (opposingSpreader) {
       return SEDPNRState::PROPAGATING;
     }
 
-    // Truth claims should not be recovered from
-    double probNtoR = claim.isMisinformation ? cfg.prob_n_to_r : 0.0;
-
-    if (dist(rng) < probNtoR) {
+    // Truth claims should not be recovered from (probNtoR is zero)
+    if (draw(dist) < cp.probNtoR) {
       return SEDPNRState::RECOVERED;
     }
 
@@ -595,37 +1551,55 @@ private:
   // STATE COUNTING
   // ========================================================================
 
-  void recordStateCounts() {
-    for (const auto &claim : claims) {
-      StateCounts counts;
+  // Map a new claim's (non-negative) ID to its index in claims
+  void registerClaimId(int claimId) {
+    if (claimId >= static_cast<int>(claimIndexById.size()))
+      claimIndexById.resize(claimId + 1, -1);
+    claimIndexById[claimId] = static_cast<int>(claims.size()) - 1;
+    activityValid = false;
+  }
 
-      for (const auto &agent : city.agents) {
-        switch (agent.getState(claim.claimId)) {
-        case SEDPNRState::SUSCEPTIBLE:
-          counts.susceptible++;
-          break;
-        case SEDPNRState::EXPOSED:
-          counts.exposed++;
-          break;
-        case SEDPNRState::DOUBTFUL:
-          counts.doubtful++;
-          break;
-        case SEDPNRState::PROPAGATING:
-          counts.propagating++;
-          break;
-        case SEDPNRState::NOT_SPREADING:
-          counts.notSpreading++;
-          break;
-        case SEDPNRState::RECOVERED:
-          counts.recovered++;
-          break;
-        default:
-          break;
-        }
-      }
+  // Size a claim's history for the whole run so recording never reallocates
+  void reserveHistory(int claimId) {
+    if (params.timesteps > 0) {
+      size_t records = params.timesteps / params.output_interval + 1;
+      stateHistory[claimId].reserve(records);
+      flowHistory[claimId].reserve(records);
+    }
+  }
 
-      stateHistory[claim.claimId].push_back(counts);
+  // Append the ledger's counts and the flows since the last record: O(claims)
+  void recordStateCounts() {
+    for (size_t c = 0; c < claims.size(); ++c) {
+      int claimId = claims[c].claimId;
+      stateHistory[claimId].push_back(ledger.current(c));
+      flowHistory[claimId].push_back(ledger.takeFlows(c));
     }
+    writeResultsArrow(0);
+  }
+
+  // Start the ledgers of a newly added claim (after its seeding)
+  void trackClaim(size_t c) {
+    int claimId = claims[c].claimId;
+    ledger.addClaim(countStates(claimId));
+    if (!local.empty()) {
+      local.addClaim();
+      for (const auto &agent : city.agents)
+        local.count(c, agent, agent.getState(claimId));
+    }
+    if (!demographics.empty()) {
+      demographics.addClaim();
+      for (size_t i = 0; i < city.agents.size(); ++i)
+        demographics.count(c, i, city.agents[i].getState(claimId));
+    }
+  }
+
+  // Full scan of one claim's states (used once when a claim is added)
+  StateCounts countStates(int claimId) const {
+    StateCounts counts;
+    for (const auto &agent : city.agents)
+      counts.add(agent.getState(claimId));
+    return counts;
   }
 
   // ========================================================================
@@ -0,0 +1,488 @@
+#pragma once
+
+#include "SEDPNR.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// SNAPSHOT INDEX
+// With spatial_index=true the simulation indexes spatial_data.csv while it
+// writes it and saves the index next to it as spatial_data.csv.idx, so that
+// SnapshotStore (SnapshotStore.h) and the `query` tool can answer point and
+// range queries without scanning the dump. The file is a header followed
+// by flat sections, each 8-byte aligned, in native byte order:
+//   frames   one IndexFrame per record: time, byte range and row count
+//   claims   one IndexClaim per claim, in order of first row
+//   agents   one IndexAgent per agent ID (town, locations, demographics)
+//   changes  the rows where an agent's state for a claim differs from
+//            its previous row, as IndexChange (time, state), grouped by
+//            (claim slot, agent) and in time order within a group. They
+//            are located by one of two layouts, whichever is smaller:
+//            dense   offsets[claims * agents + 1]
+//            sparse  (flag SNAPSHOT_INDEX_SPARSE_CHANGES) per-claim CSR
+//                    over the agents that have changes:
+//                    keyStart[claims + 1] into keyAgent[keys] (ascending
+//                    within a claim, padded to 8 bytes), and
+//                    keyChanges[keys + 1] into the changes
+//            Sparse dumps of news-cycle runs, where most claims never
+//            reach most agents, take the sparse layout; full dumps the
+//            dense one
+//   members  CSR over location ID (offsets[locations + 1], agent IDs),
+//            padded to 8 bytes, then the same over town ID
+//   spells   (version 3) one IndexSpell per change: the records from the
+//            change up to the agent's next change for the claim. Grouped
+//            by (claim slot, town, state) through
+//            offsets[claims * towns * NUM_STATES + 1], padded to 8 bytes
+//            before them. Each group is a priority search tree in heap
+//            order (children of i at 2i+1 and 2i+2): a node holds the
+//            spell ending last in its subtree, and the left subtree the
+//            earlier starts of the rest, so "which agents of a town held a
+//            state during [from, to]" costs O(log n) plus the spells found
+// Changes are only seen at record times. In sparse dumps
+// (full_spatial_snapshot=false) a missing row means Susceptible, which
+// agents never return to, so the lists are exact there as well. There the
+// S rows of the first record are not listed: a list starts at the change
+// away from S, and pairs that never leave S have none. Sampled dumps (see
+// SpatialSampler.h) only see changes at the records an agent was sampled
+// at; a missing row means nothing there.
+// ============================================================================
+
+constexpr char SNAPSHOT_INDEX_MAGIC[8] = {'S', 'E', 'D', 'P', 'I', 'D', 'X', '1'};
+constexpr uint32_t SNAPSHOT_INDEX_FULL = 1;    // Flag: every row was written
+constexpr uint32_t SNAPSHOT_INDEX_SAMPLED = 2; // Flag: rows of a sample only
+constexpr uint32_t SNAPSHOT_INDEX_SPARSE_CHANGES = 4; // Flag: sparse layout
+constexpr uint32_t SNAPSHOT_INDEX_VERSION = 3; // 1: dense only, 2: no spells
+constexpr int SNAPSHOT_INDEX_STATES = static_cast<int>(SEDPNRState::NUM_STATES);
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t dataBytes; // Size of the CSV the index describes
+  uint32_t frames;
+  uint32_t claims;
+  uint32_t agents;
+  uint32_t locations;
+  uint32_t towns;
+  uint32_t reserved;
+  uint64_t changes;
+  uint64_t memberships; // Location memberships (sum of the location lists)
+};
+
+struct IndexFrame {
+  int32_t time;
+  uint32_t rows;
+  uint64_t begin; // Byte range of the frame's rows in the CSV
+  uint64_t end;
+};
+
+struct IndexClaim {
+  int32_t claimId;
+  int32_t isMisinfo;
+};
+
+struct IndexAgent {
+  int32_t townId = -1; // -1 for IDs that never had a row
+  int32_t schoolId = -1;
+  int32_t religiousId = -1;
+  int32_t workplaceId = -1;
+  int32_t ethnicity = 0;
+  int32_t denomination = 0;
+};
+
+struct IndexChange {
+  int32_t time;
+  int32_t state;
+};
+
+struct IndexSpell {
+  int32_t start;    // Time of the change into the state
+  int32_t end;      // Time of the next change, INT32_MAX if none
+  int32_t agent;
+  int32_t minStart; // Earliest start in this node's subtree
+};
+
+// Writer side: fed every row as it is written, saved once at the end.
+// Change rows are spilled to an anonymous temporary file as they arrive,
+// so with reserve() called up front add() does not allocate per record
+class SnapshotIndexWriter {
+public:
+  SnapshotIndexWriter() = default;
+  SnapshotIndexWriter(const SnapshotIndexWriter &) = delete;
+  SnapshotIndexWriter &operator=(const SnapshotIndexWriter &) = delete;
+  SnapshotIndexWriter(SnapshotIndexWriter &&other) noexcept {
+    *this = std::move(other);
+  }
+  SnapshotIndexWriter &operator=(SnapshotIndexWriter &&other) noexcept {
+    if (this != &other) {
+      closeSpill();
+      active = other.active;
+      full = other.full;
+      sampled = other.sampled;
+      offset = other.offset;
+      frames = std::move(other.frames);
+      claims = std::move(other.claims);
+      slotOf = std::move(other.slotOf);
+      lastClaim = other.lastClaim;
+      lastSlot = other.lastSlot;
+      agentHint = other.agentHint;
+      agents = std::move(other.agents);
+      lastState = std::move(other.lastState);
+      pending = std::move(other.pending);
+      spill = other.spill;
+      spilled = other.spilled;
+      other.spill = nullptr;
+      other.spilled = 0;
+    }
+    return *this;
+  }
+  ~SnapshotIndexWriter() { closeSpill(); }
+
+  // Start indexing a dump whose header line is headerBytes long
+  void start(uint64_t headerBytes, bool fullSnapshots, bool sampledRows) {
+    *this = SnapshotIndexWriter();
+    offset = headerBytes;
+    full = fullSnapshots;
+    sampled = sampledRows;
+    active = true;
+  }
+
+  // Size the per-record and per-agent tables for the whole run
+  void reserve(size_t records, size_t agentCount) {
+    frames.reserve(records);
+    agents.reserve(agentCount);
+    agentHint = agentCount;
+  }
+
+  // Push spilled rows to the file (before a fork, so that no child
+  // inherits them buffered)
+  void flush() {
+    if (spill)
+      std::fflush(spill);
+  }
+
+  bool isActive() const { return active; }
+
+  void add(int time, int agentId, int claimId, bool isMisinfo,
+           const IndexAgent &where, int state, size_t rowBytes) {
+    if (!active || agentId < 0)
+      return;
+    if (frames.empty() || frames.back().time != time)
+      frames.push_back({time, 0, offset, offset});
+    IndexFrame &frame = frames.back();
+    frame.rows++;
+    offset += rowBytes;
+    frame.end = offset;
+
+    // Rows arrive grouped by claim, so the last slot usually matches; the
+    // map is only inserted into for a new claim (emplace would allocate a
+    // node for every row)
+    if (claimId != lastClaim) {
+      auto it = slotOf.find(claimId);
+      if (it == slotOf.end()) {
+        it = slotOf.emplace(claimId, static_cast<uint32_t>(claims.size()))
+                 .first;
+        claims.push_back({claimId, isMisinfo ? 1 : 0});
+        lastState.emplace_back();
+        lastState.back().reserve(agentHint);
+      }
+      lastClaim = claimId;
+      lastSlot = it->second;
+    }
+    uint32_t slot = lastSlot;
+
+    size_t a = static_cast<size_t>(agentId);
+    if (a >= agents.size())
+      agents.resize(a + 1);
+    if (agents[a].townId < 0)
+      agents[a] = where;
+
+    // Before its first row an agent is S in sparse dumps, unknown otherwise
+    std::vector<int8_t> &last = lastState[slot];
+    if (a >= last.size())
+      last.resize(a + 1, full || sampled ? -1 : 0);
+    if (last[a] != state) {
+      last[a] = static_cast<int8_t>(state);
+      Pending row{slot, agentId, time, state};
+      if (!spill && spilled == 0 && pending.empty())
+        spill = std::tmpfile(); // Kept in memory if that fails
+      if (spill && pending.empty() &&
+          std::fwrite(&row, sizeof(row), 1, spill) == 1)
+        spilled++;
+      else
+        pending.push_back(row);
+    }
+  }
+
+  // Write the index; returns false if the file cannot be written
+  bool save(const std::string &path) const {
+    if (!active)
+      return false;
+    std::vector<Pending> spilledRows;
+    if (!readSpill(spilledRows))
+      return false;
+    const std::vector<Pending> &rows =
+        spilledRows.empty() ? pending : spilledRows;
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+      return false;
+
+    // Changes, grouped by (slot, agent): a counting sort by slot, then a
+    // stable sort by agent within each slot. Rows are in time order, so
+    // each list stays sorted by time
+    size_t n = agents.size(), slots = claims.size();
+    std::vector<uint64_t> keyStart(slots + 1, 0);
+    for (const Pending &p : rows)
+      keyStart[p.slot + 1]++;
+    for (size_t c = 0; c < slots; ++c)
+      keyStart[c + 1] += keyStart[c];
+    std::vector<Pending> grouped(rows.size());
+    {
+      std::vector<uint64_t> fill(keyStart.begin(), keyStart.end() - 1);
+      for (const Pending &p : rows)
+        grouped[fill[p.slot]++] = p;
+    }
+    for (size_t c = 0; c < slots; ++c)
+      std::stable_sort(grouped.begin() + keyStart[c],
+                       grouped.begin() + keyStart[c + 1],
+                       [](const Pending &a, const Pending &b) {
+                         return a.agent < b.agent;
+                       });
+
+    // One key per (slot, agent) with rows; keyStart becomes the per-slot
+    // range of keys instead of rows
+    std::vector<IndexChange> changes(grouped.size());
+    std::vector<int32_t> keyAgent;
+    std::vector<uint64_t> keyChanges;
+    for (size_t c = 0; c < slots; ++c) {
+      uint64_t first = keyAgent.size();
+      for (uint64_t i = keyStart[c]; i < keyStart[c + 1]; ++i) {
+        const Pending &p = grouped[i];
+        if (i == keyStart[c] || p.agent != grouped[i - 1].agent) {
+          keyAgent.push_back(p.agent);
+          keyChanges.push_back(i);
+        }
+        changes[i] = {p.time, p.state};
+      }
+      keyStart[c] = first;
+    }
+    keyStart[slots] = keyAgent.size();
+    keyChanges.push_back(changes.size());
+    size_t keys = keyAgent.size();
+    bool sparse = (slots + 1 + keys + 1) * sizeof(uint64_t) +
+                      (keys + 1) * sizeof(int32_t) <
+                  (slots * n + 1) * sizeof(uint64_t);
+    std::vector<uint64_t> changeStart;
+    if (!sparse) {
+      changeStart.assign(slots * n + 1, 0);
+      for (size_t c = 0; c < slots; ++c) {
+        for (uint64_t k = keyStart[c]; k < keyStart[c + 1]; ++k)
+          changeStart[c * n + keyAgent[k] + 1] =
+              keyChanges[k + 1] - keyChanges[k];
+      }
+      for (size_t k = 0; k < slots * n; ++k)
+        changeStart[k + 1] += changeStart[k];
+    }
+
+    // Memberships, agents ascending within each location and town
+    int32_t locations = 0, towns = 0;
+    for (const IndexAgent &a : agents) {
+      towns = std::max(towns, a.townId + 1);
+      for (int32_t loc : {a.schoolId, a.religiousId, a.workplaceId})
+        locations = std::max(locations, loc + 1);
+    }
+    std::vector<uint64_t> locStart(locations + 1, 0), townStart(towns + 1, 0);
+    for (const IndexAgent &a : agents) {
+      if (a.townId >= 0)
+        townStart[a.townId + 1]++;
+      for (int32_t loc : {a.schoolId, a.religiousId, a.workplaceId})
+        if (loc >= 0)
+          locStart[loc + 1]++;
+    }
+    for (int32_t l = 0; l < locations; ++l)
+      locStart[l + 1] += locStart[l];
+    for (int32_t t = 0; t < towns; ++t)
+      townStart[t + 1] += townStart[t];
+    std::vector<int32_t> locMembers(locStart.back()), townMembers(
+                                                          townStart.back());
+    std::vector<uint64_t> locFill(locStart.begin(), locStart.end() - 1);
+    std::vector<uint64_t> townFill(townStart.begin(), townStart.end() - 1);
+    for (size_t id = 0; id < n; ++id) {
+      const IndexAgent &a = agents[id];
+      if (a.townId >= 0)
+        townMembers[townFill[a.townId]++] = static_cast<int32_t>(id);
+      for (int32_t loc : {a.schoolId, a.religiousId, a.workplaceId})
+        if (loc >= 0)
+          locMembers[locFill[loc]++] = static_cast<int32_t>(id);
+    }
+
+    // Spells, one per change, grouped by (slot, town, state) with a counting
+    // sort, then each group sorted by start and laid out as a search tree
+    size_t groups = slots * static_cast<size_t>(towns) * SNAPSHOT_INDEX_STATES;
+    auto groupOf = [&](size_t i) {
+      const Pending &p = grouped[i];
+      return (p.slot * static_cast<size_t>(towns) + agents[p.agent].townId) *
+                 SNAPSHOT_INDEX_STATES +
+             p.state;
+    };
+    std::vector<uint64_t> spellStart(groups + 1, 0);
+    for (size_t i = 0; i < grouped.size(); ++i)
+      spellStart[groupOf(i) + 1]++;
+    for (size_t g = 0; g < groups; ++g)
+      spellStart[g + 1] += spellStart[g];
+    std::vector<IndexSpell> sorted(grouped.size()), spells(grouped.size());
+    {
+      std::vector<uint64_t> fill(spellStart.begin(), spellStart.end() - 1);
+      for (size_t i = 0; i < grouped.size(); ++i) {
+        const Pending &p = grouped[i];
+        bool last = i + 1 == grouped.size() ||
+                    grouped[i + 1].slot != p.slot ||
+                    grouped[i + 1].agent != p.agent;
+        sorted[fill[groupOf(i)]++] = {p.time, last ? INT32_MAX
+                                                   : grouped[i + 1].time,
+                                      p.agent, p.time};
+      }
+    }
+    for (size_t g = 0; g < groups; ++g) {
+      IndexSpell *first = sorted.data() + spellStart[g];
+      IndexSpell *last = sorted.data() + spellStart[g + 1];
+      std::sort(first, last, [](const IndexSpell &a, const IndexSpell &b) {
+        return a.start != b.start ? a.start < b.start : a.agent < b.agent;
+      });
+      buildSpellTree(first, last, 0, spells.data() + spellStart[g],
+                     static_cast<size_t>(last - first));
+    }
+
+    IndexHeader h{};
+    std::copy(SNAPSHOT_INDEX_MAGIC, SNAPSHOT_INDEX_MAGIC + 8, h.magic);
+    h.version = SNAPSHOT_INDEX_VERSION;
+    h.flags = (full ? SNAPSHOT_INDEX_FULL : 0) |
+              (sampled ? SNAPSHOT_INDEX_SAMPLED : 0) |
+              (sparse ? SNAPSHOT_INDEX_SPARSE_CHANGES : 0);
+    h.dataBytes = offset;
+    h.frames = static_cast<uint32_t>(frames.size());
+    h.claims = static_cast<uint32_t>(claims.size());
+    h.agents = static_cast<uint32_t>(n);
+    h.locations = static_cast<uint32_t>(locations);
+    h.towns = static_cast<uint32_t>(towns);
+    h.changes = changes.size();
+    h.memberships = locMembers.size();
+
+    bool ok = put(f, &h, 1) && put(f, frames.data(), frames.size()) &&
+              put(f, claims.data(), claims.size()) &&
+              put(f, agents.data(), agents.size());
+    if (sparse)
+      ok = ok && put(f, keyStart.data(), keyStart.size()) &&
+           put(f, keyAgent.data(), keyAgent.size()) && pad(f) &&
+           put(f, keyChanges.data(), keyChanges.size());
+    else
+      ok = ok && put(f, changeStart.data(), changeStart.size());
+    ok = ok && put(f, changes.data(), changes.size()) &&
+         put(f, locStart.data(), locStart.size()) &&
+         put(f, locMembers.data(), locMembers.size()) && pad(f) &&
+         put(f, townStart.data(), townStart.size()) &&
+         put(f, townMembers.data(), townMembers.size()) && pad(f) &&
+         put(f, spellStart.data(), spellStart.size()) &&
+         put(f, spells.data(), spells.size());
+    return std::fclose(f) == 0 && ok;
+  }
+
+  // Heap held by the index so far, for the memory report
+  size_t bytes() const {
+    size_t total = frames.capacity() * sizeof(IndexFrame) +
+                   claims.capacity() * sizeof(IndexClaim) +
+                   agents.capacity() * sizeof(IndexAgent) +
+                   pending.capacity() * sizeof(Pending);
+    for (const auto &last : lastState)
+      total += last.capacity();
+    return total;
+  }
+
+private:
+  struct Pending {
+    uint32_t slot;
+    int32_t agent;
+    int32_t time;
+    int32_t state;
+  };
+
+  // Spilled change rows, in the order they were added; false on a read
+  // error. Once a write fails the rest are kept in pending, after them
+  bool readSpill(std::vector<Pending> &rows) const {
+    if (!spill || spilled == 0)
+      return true;
+    rows.resize(spilled);
+    if (std::fflush(spill) != 0 || std::fseek(spill, 0, SEEK_SET) != 0 ||
+        std::fread(rows.data(), sizeof(Pending), spilled, spill) != spilled)
+      return false;
+    rows.insert(rows.end(), pending.begin(), pending.end());
+    return std::fseek(spill, 0, SEEK_END) == 0;
+  }
+
+  void closeSpill() {
+    if (spill)
+      std::fclose(spill);
+    spill = nullptr;
+    spilled = 0;
+  }
+
+  template <typename T> static bool put(std::FILE *f, const T *p, size_t n) {
+    return n == 0 || std::fwrite(p, sizeof(T), n, f) == n;
+  }
+
+  // Nodes in the subtree of `node` of an n-node tree in heap order
+  static size_t subtreeSize(size_t node, size_t n) {
+    size_t size = 0;
+    for (size_t lo = node, hi = node; lo < n; lo = 2 * lo + 1, hi = 2 * hi + 2)
+      size += std::min(hi, n - 1) - lo + 1;
+    return size;
+  }
+
+  // Lay out [first, last), sorted by start, as the subtree of `node`: the
+  // spell ending last at the node, the rest split by start between the
+  // children. Rotating the chosen spell out keeps the rest sorted
+  static void buildSpellTree(IndexSpell *first, IndexSpell *last,
+                             size_t node, IndexSpell *tree, size_t n) {
+    if (first == last)
+      return;
+    int32_t minStart = first->start;
+    IndexSpell *top = std::max_element(
+        first, last,
+        [](const IndexSpell &a, const IndexSpell &b) { return a.end < b.end; });
+    std::rotate(first, top, top + 1);
+    tree[node] = *first;
+    tree[node].minStart = minStart;
+    IndexSpell *split = first + 1 + subtreeSize(2 * node + 1, n);
+    buildSpellTree(first + 1, split, 2 * node + 1, tree, n);
+    buildSpellTree(split, last, 2 * node + 2, tree, n);
+  }
+
+  // Keep the next section 8-byte aligned after an int32 section
+  static bool pad(std::FILE *f) {
+    long at = std::ftell(f);
+    static const char zeros[8] = {};
+    return at >= 0 && put(f, zeros, static_cast<size_t>((8 - at % 8) % 8));
+  }
+
+  bool active = false;
+  bool full = false;
+  bool sampled = false;
+  uint64_t offset = 0;
+  std::vector<IndexFrame> frames;
+  std::vector<IndexClaim> claims;
+  std::unordered_map<int, uint32_t> slotOf;
+  int lastClaim = -1; // Claim of the previous row and its slot
+  uint32_t lastSlot = 0;
+  size_t agentHint = 0; // Agent count passed to reserve()
+  std::vector<IndexAgent> agents;
+  std::vector<std::vector<int8_t>> lastState; // [slot][agent], -1 = no row
+  std::vector<Pending> pending; // Change rows not in the spill file
+  std::FILE *spill = nullptr;   // Change rows in order, see add()
+  size_t spilled = 0;
+};
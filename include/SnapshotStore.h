@@ -0,0 +1,311 @@
+#pragma once
+
+#include "SEDPNR.h"
+#include "SnapshotIndex.h"
+#include "SpatialLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// SNAPSHOT STORE
+// Read side of the snapshot index: maps spatial_data.csv and its .idx and
+// answers queries from the index sections without scanning the dump.
+//   stateAt / changes    binary search in one (claim, agent) change list
+//                        (found directly, or by a binary search over the
+//                        claim's agents in the sparse layout)
+//   frame / forEachRow   byte range of one record, parsed on demand
+//   members              agent IDs of a location or town
+//   inState              members of a location or town that held a state
+//                        during a time window, one binary search per member
+//   townInState          the same for a town, from the town's spell tree
+// Point queries and townInState cost O(log n) plus the rows returned.
+// townInState falls back to inState for indexes without spells (version
+// 1 and 2) and for S in sparse, unsampled dumps, where S is not listed.
+// ============================================================================
+
+template <typename T> struct IndexSpan {
+  const T *first = nullptr;
+  const T *last = nullptr;
+
+  const T *begin() const { return first; }
+  const T *end() const { return last; }
+  size_t size() const { return static_cast<size_t>(last - first); }
+  bool empty() const { return first == last; }
+  const T &operator[](size_t i) const { return first[i]; }
+};
+
+class SnapshotStore {
+public:
+  // Open csvPath and csvPath + ".idx"; check ok() and error()
+  explicit SnapshotStore(const std::string &csvPath)
+      : csv(csvPath), idx(csvPath + ".idx") {
+    if (!csv.ok() || !idx.ok()) {
+      err = "cannot read " + (csv.ok() ? csvPath + ".idx" : csvPath);
+      return;
+    }
+    if (idx.size() < sizeof(IndexHeader) ||
+        std::memcmp(idx.data(), SNAPSHOT_INDEX_MAGIC, 8) != 0) {
+      err = csvPath + ".idx is not a snapshot index";
+      return;
+    }
+    std::memcpy(&h, idx.data(), sizeof(h));
+    if (h.version < 1 || h.version > SNAPSHOT_INDEX_VERSION) {
+      err = "unsupported index version " + std::to_string(h.version);
+      return;
+    }
+    if (h.dataBytes != csv.size()) {
+      err = csvPath + " changed since it was indexed";
+      return;
+    }
+
+    // Lay out the sections as SnapshotIndexWriter::save() wrote them
+    size_t at = sizeof(IndexHeader);
+    bool fits = true;
+    auto section = [&](auto &span, size_t count) {
+      using T = std::remove_reference_t<decltype(*span.first)>;
+      at = (at + alignof(T) - 1) / alignof(T) * alignof(T);
+      if (at + count * sizeof(T) > idx.size()) {
+        fits = false;
+        return;
+      }
+      span.first = reinterpret_cast<const T *>(idx.data() + at);
+      span.last = span.first + count;
+      at += count * sizeof(T);
+    };
+    section(frameSpan, h.frames);
+    section(claimSpan, h.claims);
+    section(agentSpan, h.agents);
+    uint64_t keys = static_cast<uint64_t>(h.claims) * h.agents;
+    if (sparseChanges()) {
+      section(keyStart, h.claims + 1);
+      keys = fits ? keyStart[h.claims] : 0;
+      section(keyAgent, keys);
+      section(changeStart, keys + 1); // keyChanges
+    } else {
+      section(changeStart, keys + 1);
+    }
+    section(changeRows, h.changes);
+    section(locStart, h.locations + 1);
+    section(locMemberRows, h.memberships);
+    section(townStart, h.towns + 1);
+    if (fits)
+      section(townMemberRows, townStart[h.towns]);
+    uint64_t groups = static_cast<uint64_t>(h.claims) * h.towns *
+                      SNAPSHOT_INDEX_STATES;
+    if (fits && h.version >= 3) {
+      section(spellStart, groups + 1);
+      if (fits)
+        section(spellRows, spellStart[groups]);
+      fits = fits && spellStart[groups] == h.changes;
+    }
+    if (!fits || changeStart[keys] != h.changes) {
+      err = csvPath + ".idx is truncated";
+      return;
+    }
+    for (size_t c = 0; c < claimSpan.size(); ++c)
+      slotOf[claimSpan[c].claimId] = static_cast<uint32_t>(c);
+  }
+
+  bool ok() const { return err.empty(); }
+  const std::string &error() const { return err; }
+
+  // True if every agent has a row at every record; otherwise a missing row
+  // means Susceptible, unless the dump is sampled
+  bool fullSnapshots() const { return h.flags & SNAPSHOT_INDEX_FULL; }
+
+  // True if the dump holds a panel or reservoir sample of the agents: a
+  // missing row says nothing about the agent's state
+  bool sampled() const { return h.flags & SNAPSHOT_INDEX_SAMPLED; }
+
+  IndexSpan<IndexFrame> frames() const { return frameSpan; }
+  IndexSpan<IndexClaim> claims() const { return claimSpan; }
+  size_t agentCount() const { return agentSpan.size(); }
+  size_t locationCount() const { return h.locations; }
+  size_t townCount() const { return h.towns; }
+  size_t changeCount() const { return changeRows.size(); }
+
+  // True if the change lists are located through per-claim agent keys
+  bool sparseChanges() const { return h.flags & SNAPSHOT_INDEX_SPARSE_CHANGES; }
+
+  // Static row of an agent, nullptr for unknown IDs
+  const IndexAgent *agent(int agentId) const {
+    if (agentId < 0 || static_cast<size_t>(agentId) >= agentSpan.size() ||
+        agentSpan[agentId].townId < 0)
+      return nullptr;
+    return &agentSpan[agentId];
+  }
+
+  // Record at `time`, nullptr if there is none
+  const IndexFrame *frame(int time) const {
+    const IndexFrame *f = std::lower_bound(
+        frameSpan.begin(), frameSpan.end(), time,
+        [](const IndexFrame &a, int t) { return a.time < t; });
+    return f != frameSpan.end() && f->time == time ? f : nullptr;
+  }
+
+  // Call fn(row) for every parsed row of the record at `time`
+  template <typename Fn> size_t forEachRow(int time, Fn fn) const {
+    const IndexFrame *f = frame(time);
+    if (!f)
+      return 0;
+    const char *p = csv.data() + f->begin, *end = csv.data() + f->end;
+    size_t rows = 0;
+    int rowTime = 0;
+    Snapshot s;
+    while (p < end) {
+      if (parseSpatialRow(p, end, rowTime, s)) {
+        fn(s);
+        rows++;
+      }
+    }
+    return rows;
+  }
+
+  // Raw CSV bytes of the record at `time` (empty if there is none)
+  std::pair<const char *, const char *> frameText(int time) const {
+    const IndexFrame *f = frame(time);
+    if (!f)
+      return {nullptr, nullptr};
+    return {csv.data() + f->begin, csv.data() + f->end};
+  }
+
+  // State changes of an agent for a claim, in time order
+  IndexSpan<IndexChange> changes(int agentId, int claimId) const {
+    auto it = slotOf.find(claimId);
+    if (it == slotOf.end() || agentId < 0 ||
+        static_cast<size_t>(agentId) >= agentSpan.size())
+      return {};
+    size_t key = it->second * agentSpan.size() + agentId;
+    if (sparseChanges()) {
+      const int32_t *first = keyAgent.first + keyStart[it->second];
+      const int32_t *last = keyAgent.first + keyStart[it->second + 1];
+      const int32_t *at = std::lower_bound(first, last, agentId);
+      if (at == last || *at != agentId)
+        return {};
+      key = static_cast<size_t>(at - keyAgent.first);
+    }
+    return {changeRows.first + changeStart[key],
+            changeRows.first + changeStart[key + 1]};
+  }
+
+  // State at the last record at or before `time`; -1 if the agent has no
+  // row for the claim by then (Susceptible in sparse, unsampled dumps).
+  // In sampled dumps this is the state at the agent's last sampled row
+  int stateAt(int agentId, int claimId, int time) const {
+    IndexSpan<IndexChange> list = changes(agentId, claimId);
+    const IndexChange *c = std::upper_bound(
+        list.begin(), list.end(), time,
+        [](int t, const IndexChange &a) { return t < a.time; });
+    if (c != list.begin())
+      return (c - 1)->state;
+    if (fullSnapshots() || sampled())
+      return -1;
+    return static_cast<int>(SEDPNRState::SUSCEPTIBLE);
+  }
+
+  // True if the agent was in `state` at some record in [from, to]
+  bool heldState(int agentId, int claimId, int state, int from,
+                 int to) const {
+    if (stateAt(agentId, claimId, from) == state)
+      return true;
+    IndexSpan<IndexChange> list = changes(agentId, claimId);
+    const IndexChange *c = std::upper_bound(
+        list.begin(), list.end(), from,
+        [](int t, const IndexChange &a) { return t < a.time; });
+    for (; c != list.end() && c->time <= to; ++c) {
+      if (c->state == state)
+        return true;
+    }
+    return false;
+  }
+
+  IndexSpan<int32_t> locationMembers(int locationId) const {
+    if (locationId < 0 || static_cast<uint32_t>(locationId) >= h.locations)
+      return {};
+    return {locMemberRows.first + locStart[locationId],
+            locMemberRows.first + locStart[locationId + 1]};
+  }
+
+  IndexSpan<int32_t> townMembers(int townId) const {
+    if (townId < 0 || static_cast<uint32_t>(townId) >= h.towns)
+      return {};
+    return {townMemberRows.first + townStart[townId],
+            townMemberRows.first + townStart[townId + 1]};
+  }
+
+  // Members that held `state` for the claim at some record in [from, to]
+  std::vector<int> inState(IndexSpan<int32_t> members, int claimId,
+                           int state, int from, int to) const {
+    std::vector<int> out;
+    for (int32_t id : members) {
+      if (heldState(id, claimId, state, from, to))
+        out.push_back(id);
+    }
+    return out;
+  }
+
+  // Agents of a town that held `state` for the claim at some record in
+  // [from, to], ascending: the spells that start by `to` and end after
+  // `from`, found by walking the (claim, town, state) tree
+  std::vector<int> townInState(int townId, int claimId, int state, int from,
+                               int to) const {
+    auto it = slotOf.find(claimId);
+    if (spellStart.empty() || state < 0 || state >= SNAPSHOT_INDEX_STATES ||
+        (state == static_cast<int>(SEDPNRState::SUSCEPTIBLE) &&
+         !fullSnapshots() && !sampled()))
+      return inState(townMembers(townId), claimId, state, from, to);
+    std::vector<int> out;
+    if (it == slotOf.end() || townId < 0 ||
+        static_cast<uint32_t>(townId) >= h.towns)
+      return out;
+    size_t g = (it->second * static_cast<size_t>(h.towns) + townId) *
+                   SNAPSHOT_INDEX_STATES +
+               state;
+    IndexSpan<IndexSpell> tree{spellRows.first + spellStart[g],
+                               spellRows.first + spellStart[g + 1]};
+    collectSpells(tree, 0, from, to, out);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+  }
+
+private:
+  // A subtree is skipped when all of its spells start after `to` or end
+  // by `from`; the nodes visited are the ones reported, their children
+  // and one root-to-leaf path
+  static void collectSpells(IndexSpan<IndexSpell> tree, size_t node, int from,
+                            int to, std::vector<int> &out) {
+    if (node >= tree.size())
+      return;
+    const IndexSpell &s = tree[node];
+    if (s.minStart > to || s.end <= from)
+      return;
+    if (s.start <= to)
+      out.push_back(s.agent);
+    collectSpells(tree, 2 * node + 1, from, to, out);
+    collectSpells(tree, 2 * node + 2, from, to, out);
+  }
+
+  MappedFile csv;
+  MappedFile idx;
+  std::string err;
+  IndexHeader h{};
+  IndexSpan<IndexFrame> frameSpan;
+  IndexSpan<IndexClaim> claimSpan;
+  IndexSpan<IndexAgent> agentSpan;
+  IndexSpan<uint64_t> keyStart; // Sparse layout only
+  IndexSpan<int32_t> keyAgent;
+  IndexSpan<uint64_t> changeStart; // Per key: dense (claim, agent) or sparse
+  IndexSpan<IndexChange> changeRows;
+  IndexSpan<uint64_t> locStart;
+  IndexSpan<int32_t> locMemberRows;
+  IndexSpan<uint64_t> townStart;
+  IndexSpan<int32_t> townMemberRows;
+  IndexSpan<uint64_t> spellStart; // Version 3: per (claim, town, state)
+  IndexSpan<IndexSpell> spellRows;
+  std::unordered_map<int, uint32_t> slotOf;
+};
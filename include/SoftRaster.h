@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// SOFTWARE RASTERIZER
+// Minimal CPU renderer for headless frame export: an RGBA framebuffer with
+// alpha-blended convex polygons, polygon rings (outlines), one-pixel lines
+// and a 3x5 bitmap font for digits. Coverage is sampled once at each pixel
+// centre, so there is no anti-aliasing, but one polygon never blends the
+// same pixel twice and there is no dependency on a window, GPU or display.
+// ============================================================================
+
+struct Rgba {
+  uint8_t r = 0, g = 0, b = 0, a = 255;
+};
+
+struct Point2 {
+  float x = 0, y = 0;
+};
+
+class Canvas {
+public:
+  Canvas(int width, int height)
+      : w(width), h(height), pixels(static_cast<size_t>(width) * height * 4) {}
+
+  int width() const { return w; }
+  int height() const { return h; }
+  const uint8_t *data() const { return pixels.data(); }
+
+  void clear(Rgba c) {
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+      pixels[i] = c.r;
+      pixels[i + 1] = c.g;
+      pixels[i + 2] = c.b;
+      pixels[i + 3] = c.a;
+    }
+  }
+
+  // Source-over blend of one pixel; the framebuffer stays opaque
+  void blend(int x, int y, Rgba c) {
+    if (x < 0 || y < 0 || x >= w || y >= h)
+      return;
+    uint8_t *p = &pixels[(static_cast<size_t>(y) * w + x) * 4];
+    if (c.a == 255) {
+      p[0] = c.r;
+      p[1] = c.g;
+      p[2] = c.b;
+      return;
+    }
+    int a = c.a, ia = 255 - c.a;
+    p[0] = static_cast<uint8_t>((c.r * a + p[0] * ia + 127) / 255);
+    p[1] = static_cast<uint8_t>((c.g * a + p[1] * ia + 127) / 255);
+    p[2] = static_cast<uint8_t>((c.b * a + p[2] * ia + 127) / 255);
+  }
+
+  void fillRect(float x, float y, float rw, float rh, Rgba c) {
+    int x0 = std::max(0, (int)std::ceil(x - 0.5f));
+    int x1 = std::min(w, (int)std::ceil(x + rw - 0.5f));
+    int y0 = std::max(0, (int)std::ceil(y - 0.5f));
+    int y1 = std::min(h, (int)std::ceil(y + rh - 0.5f));
+    for (int py = y0; py < y1; ++py)
+      for (int px = x0; px < x1; ++px)
+        blend(px, py, c);
+  }
+
+  // Fill the convex polygon `outer`, leaving out the convex polygon `inner`
+  // if given (used for outlines). Each row is one span, so the cost is
+  // rows x edges plus the pixels written
+  void fillConvex(const std::vector<Point2> &outer, Rgba c,
+                  const std::vector<Point2> *inner = nullptr) {
+    if (outer.size() < 3)
+      return;
+    float minY = outer[0].y, maxY = minY;
+    for (const Point2 &p : outer) {
+      minY = std::min(minY, p.y);
+      maxY = std::max(maxY, p.y);
+    }
+    int y0 = std::max(0, (int)std::ceil(minY - 0.5f));
+    int y1 = std::min(h, (int)std::ceil(maxY - 0.5f));
+    for (int py = y0; py < y1; ++py) {
+      float sy = py + 0.5f, l, r;
+      if (!span(outer, sy, l, r))
+        continue;
+      int x0 = std::max(0, (int)std::ceil(l - 0.5f));
+      int x1 = std::min(w, (int)std::ceil(r - 0.5f));
+      int h0 = x1, h1 = x1; // Hole columns [h0, h1)
+      float hl, hr;
+      if (inner && span(*inner, sy, hl, hr)) {
+        h0 = std::max(x0, (int)std::ceil(hl - 0.5f));
+        h1 = std::max(h0, (int)std::ceil(hr - 0.5f));
+      }
+      for (int px = x0; px < x1; ++px) {
+        if (px == h0)
+          px = h1;
+        if (px < x1)
+          blend(px, py, c);
+      }
+    }
+  }
+
+  void copyFrom(const Canvas &other) { pixels = other.pixels; }
+
+  // One-pixel line, one blend per pixel
+  void line(Point2 a, Point2 b, Rgba c) {
+    float dx = b.x - a.x, dy = b.y - a.y;
+    int steps = (int)std::ceil(std::max(std::fabs(dx), std::fabs(dy)));
+    if (steps == 0) {
+      blend((int)a.x, (int)a.y, c);
+      return;
+    }
+    for (int i = 0; i <= steps; ++i) {
+      float t = static_cast<float>(i) / steps;
+      blend((int)std::floor(a.x + dx * t), (int)std::floor(a.y + dy * t), c);
+    }
+  }
+
+  // Digits, '/', '.', '-' and ' ' drawn from a 3x5 font, `scale` px per dot
+  void text(float x, float y, const std::string &s, int scale, Rgba c) {
+    static const uint16_t glyphs[10] = {
+        0x7B6F, 0x2C97, 0x73E7, 0x72CF, 0x5BC9,
+        0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF};
+    for (char ch : s) {
+      uint16_t bits = 0;
+      if (ch >= '0' && ch <= '9')
+        bits = glyphs[ch - '0'];
+      else if (ch == '/')
+        bits = 0x12A4;
+      else if (ch == '.')
+        bits = 0x0002;
+      else if (ch == '-')
+        bits = 0x01C0;
+      for (int row = 0; row < 5; ++row)
+        for (int col = 0; col < 3; ++col)
+          if (bits & (1 << (14 - row * 3 - col)))
+            fillRect(x + col * scale, y + row * scale, (float)scale,
+                     (float)scale, c);
+      x += 4 * scale;
+    }
+  }
+
+private:
+  // Horizontal extent [left, right) of a convex polygon on the line y
+  static bool span(const std::vector<Point2> &poly, float y, float &left,
+                   float &right) {
+    left = 1e30f;
+    right = -1e30f;
+    for (size_t i = 0; i < poly.size(); ++i) {
+      const Point2 &a = poly[i];
+      const Point2 &b = poly[(i + 1) % poly.size()];
+      if ((a.y <= y) == (b.y <= y))
+        continue; // Edge does not cross the line
+      float x = a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y);
+      left = std::min(left, x);
+      right = std::max(right, x);
+    }
+    return left < right;
+  }
+
+  int w, h;
+  std::vector<uint8_t> pixels;
+};
+
+// Regular polygon approximating a circle or a hexagon
+inline std::vector<Point2> regularPolygon(Point2 centre, float radius,
+                                          int sides, float phase = 0) {
+  std::vector<Point2> pts(sides);
+  for (int i = 0; i < sides; ++i) {
+    float angle = phase + 2.f * static_cast<float>(M_PI) * i / sides;
+    pts[i] = {centre.x + radius * std::cos(angle),
+              centre.y + radius * std::sin(angle)};
+  }
+  return pts;
+}
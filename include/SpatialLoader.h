@@ -0,0 +1,490 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// SPATIAL DATA LOADER
+// Reads output/spatial_data.csv for the visualizer without holding it in
+// memory. The file is mapped read-only and indexed once: it is split into
+// one chunk per thread on newline boundaries, parsed with std::from_chars,
+// and every time step is recorded as byte ranges. Locations are
+// de-duplicated through hash sets per chunk, then merged in file order so
+// every town lists its schools, religious sites and workplaces in order of
+// first appearance. Frames are parsed from the mapping on demand and kept
+// in an LRU cache with a byte cap.
+// ============================================================================
+
+// Agent spatial state at a point in time
+struct Snapshot {
+  int agentId;
+  int townId;
+  int schoolId;
+  int religiousId;
+  int workplaceId;
+  int claimId;
+  int state;
+  bool isMisinfo;
+  int ethnicity = 0;
+  int denomination = 0;
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        base = static_cast<const char *>(p);
+        length = static_cast<size_t>(st.st_size);
+        madvise(p, length, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(fd);
+  }
+  ~MappedFile() {
+    if (base)
+      munmap(const_cast<char *>(base), length);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool ok() const { return base != nullptr; }
+  const char *data() const { return base; }
+  size_t size() const { return length; }
+
+private:
+  const char *base = nullptr;
+  size_t length = 0;
+};
+
+// Parse one row starting at p and move p past its newline. Returns false
+// for rows with fewer than nine integer columns or a non-integer field
+inline bool parseSpatialRow(const char *&p, const char *end, int &time,
+                            Snapshot &s) {
+  int cols[11];
+  int n = 0;
+  bool ok = true;
+  while (p < end && *p != '\n') {
+    int value = 0;
+    auto [next, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc() || n == 11)
+      ok = false;
+    else
+      cols[n++] = value;
+    p = next;
+    while (p < end && *p != ',' && *p != '\n')
+      ++p; // Skip '\r' or the rest of a bad field
+    if (p < end && *p == ',')
+      ++p;
+  }
+  if (p < end)
+    ++p;
+  if (!ok || n < 9)
+    return false;
+  time = cols[0];
+  s.agentId = cols[1];
+  s.townId = cols[2];
+  s.schoolId = cols[3];
+  s.religiousId = cols[4];
+  s.workplaceId = cols[5];
+  s.claimId = cols[6];
+  s.state = cols[7];
+  s.isMisinfo = (cols[8] == 1);
+  s.ethnicity = n >= 11 ? cols[9] : 0;
+  s.denomination = n >= 11 ? cols[10] : 0;
+  return true;
+}
+
+// Byte range of rows for one time step; a step split across several
+// ranges (never the case for files written by the simulation) gets one
+// extent per range
+struct FrameExtent {
+  int time;
+  size_t begin;
+  size_t end;
+  size_t rows;
+};
+
+// What the visualizer needs from the whole dump, built in one pass
+struct SpatialIndex {
+  std::vector<FrameExtent> frames; // Sorted by time
+  std::map<int, std::vector<int>> townSchools;
+  std::map<int, std::vector<int>> townReligious;
+  std::map<int, std::vector<int>> townWorkplaces;
+  std::map<int, std::map<int, int>> overallTrends; // [time][claim] adopted
+  std::map<int, bool> claims;   // Claim ID -> isMisinfo
+  std::vector<Snapshot> agents; // First row per agent ID; agentId -1 if none
+  int maxTime = 0;
+  size_t rows = 0;
+};
+
+namespace spatial_detail {
+
+enum LocationKind { SCHOOL, RELIGIOUS, WORKPLACE, NUM_KINDS };
+
+inline uint64_t locationKey(int town, int loc) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(town)) << 32) |
+         static_cast<uint32_t>(loc);
+}
+
+// Index of one chunk; everything is kept in file order
+struct Chunk {
+  std::vector<FrameExtent> extents;
+  std::vector<std::pair<int, int>> firstSeen[NUM_KINDS]; // (town, loc)
+  std::vector<Snapshot> firstRows; // First row of each agent in the chunk
+  std::map<int, std::map<int, int>> trends;
+  std::map<int, bool> claims;
+};
+
+inline void scanChunk(const char *base, const char *p, const char *end,
+                      Chunk &out, std::atomic<size_t> &bytesDone,
+                      const std::atomic<bool> &stop) {
+  constexpr size_t REPORT_BYTES = 1 << 22;
+  std::unordered_set<uint64_t> seen[NUM_KINDS];
+  std::vector<char> agentSeen;
+  std::map<int, int> *trend = nullptr;
+  const char *lastReport = p;
+  while (p < end) {
+    const char *rowBegin = p;
+    int time = 0;
+    Snapshot s;
+    if (parseSpatialRow(p, end, time, s)) {
+      size_t offset = static_cast<size_t>(rowBegin - base);
+      if (out.extents.empty() || out.extents.back().time != time) {
+        out.extents.push_back({time, offset, offset, 0});
+        trend = nullptr;
+      }
+      out.extents.back().end = static_cast<size_t>(p - base);
+      out.extents.back().rows++;
+
+      const int locs[NUM_KINDS] = {s.schoolId, s.religiousId, s.workplaceId};
+      for (int k = 0; k < NUM_KINDS; ++k) {
+        if (locs[k] != -1 &&
+            seen[k].insert(locationKey(s.townId, locs[k])).second)
+          out.firstSeen[k].emplace_back(s.townId, locs[k]);
+      }
+      if (s.agentId >= 0) {
+        if (static_cast<size_t>(s.agentId) >= agentSeen.size())
+          agentSeen.resize(static_cast<size_t>(s.agentId) + 1, 0);
+        if (!agentSeen[s.agentId]) {
+          agentSeen[s.agentId] = 1;
+          out.firstRows.push_back(s);
+        }
+      }
+      out.claims.emplace(s.claimId, s.isMisinfo);
+      // Adoption = P, N or R
+      if (s.state >= 3) {
+        if (!trend)
+          trend = &out.trends[time];
+        (*trend)[s.claimId]++;
+      }
+    }
+    if (static_cast<size_t>(p - lastReport) >= REPORT_BYTES) {
+      bytesDone += static_cast<size_t>(p - lastReport);
+      lastReport = p;
+      if (stop.load(std::memory_order_relaxed))
+        return;
+    }
+  }
+  bytesDone += static_cast<size_t>(p - lastReport);
+}
+
+} // namespace spatial_detail
+
+// First byte after the header line
+inline const char *skipHeaderLine(const char *begin, const char *end) {
+  const char *body = std::find(begin, end, '\n');
+  return body < end ? body + 1 : end;
+}
+
+// Cut rows [begin, end) into one chunk per thread (at most `threads`, 0
+// for one per hardware thread), at least 1 MB each, each cut just after a
+// newline. Returns the chunk boundaries, begin and end included
+inline std::vector<const char *> splitAtLines(const char *begin,
+                                              const char *end,
+                                              size_t threads = 0) {
+  size_t bytes = static_cast<size_t>(end - begin);
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::max<size_t>(1, std::min(threads, bytes / (1 << 20)));
+  std::vector<const char *> cuts = {begin};
+  for (size_t i = 1; i < threads; ++i) {
+    const char *cut = std::max(cuts.back(), begin + bytes * i / threads);
+    cut = std::find(cut, end, '\n');
+    cuts.push_back(cut < end ? cut + 1 : end);
+  }
+  cuts.push_back(end);
+  return cuts;
+}
+
+// Index a mapped spatial dump on all cores. bytesDone counts the bytes
+// scanned so far; setting stop abandons the scan
+inline SpatialIndex buildSpatialIndex(const MappedFile &file,
+                                      std::atomic<size_t> &bytesDone,
+                                      const std::atomic<bool> &stop) {
+  using namespace spatial_detail;
+  SpatialIndex index;
+  if (!file.ok())
+    return index;
+
+  auto start = std::chrono::steady_clock::now();
+  const char *begin = file.data();
+  const char *end = begin + file.size();
+  const char *body = skipHeaderLine(begin, end);
+  bytesDone += static_cast<size_t>(body - begin);
+
+  std::vector<const char *> cuts = splitAtLines(body, end);
+  size_t threads = cuts.size() - 1;
+  std::vector<Chunk> chunks(threads);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i)
+    workers.emplace_back([&, i] {
+      scanChunk(begin, cuts[i], cuts[i + 1], chunks[i], bytesDone, stop);
+    });
+  for (auto &w : workers)
+    w.join();
+  if (stop.load())
+    return index;
+
+  // Merge in file order; a step cut across two chunks becomes one extent
+  std::map<int, std::vector<int>> *lists[NUM_KINDS] = {
+      &index.townSchools, &index.townReligious, &index.townWorkplaces};
+  std::unordered_set<uint64_t> seen[NUM_KINDS];
+  for (auto &chunk : chunks) {
+    for (const auto &e : chunk.extents) {
+      auto &frames = index.frames;
+      if (!frames.empty() && frames.back().time == e.time &&
+          frames.back().end == e.begin) {
+        frames.back().end = e.end;
+        frames.back().rows += e.rows;
+      } else {
+        frames.push_back(e);
+      }
+      index.maxTime = std::max(index.maxTime, e.time);
+      index.rows += e.rows;
+    }
+    for (int k = 0; k < NUM_KINDS; ++k) {
+      for (auto [town, loc] : chunk.firstSeen[k]) {
+        if (seen[k].insert(locationKey(town, loc)).second)
+          (*lists[k])[town].push_back(loc);
+      }
+    }
+    for (const auto &s : chunk.firstRows) {
+      if (static_cast<size_t>(s.agentId) >= index.agents.size()) {
+        Snapshot none{};
+        none.agentId = -1;
+        index.agents.resize(static_cast<size_t>(s.agentId) + 1, none);
+      }
+      if (index.agents[s.agentId].agentId < 0)
+        index.agents[s.agentId] = s;
+    }
+    for (const auto &[time, byClaim] : chunk.trends)
+      for (const auto &[claim, adopted] : byClaim)
+        index.overallTrends[time][claim] += adopted;
+    index.claims.insert(chunk.claims.begin(), chunk.claims.end());
+    chunk = Chunk();
+  }
+  std::stable_sort(index.frames.begin(), index.frames.end(),
+                   [](const FrameExtent &a, const FrameExtent &b) {
+                     return a.time < b.time;
+                   });
+
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              start)
+                    .count();
+  std::cout << "Indexed " << index.rows << " rows in " << secs << " s ("
+            << static_cast<long long>(index.rows / std::max(secs, 1e-9))
+            << " rows/s, " << threads << " threads)" << std::endl;
+  return index;
+}
+
+// ============================================================================
+// PAGED TIMELINE
+// Owns the mapping and a background thread. The thread first builds the
+// index, then serves prefetch requests. frame(t) returns the rows of step
+// t, parsing them on a cache miss; least recently used frames are dropped
+// once the cache exceeds its byte cap. All methods may be called from any
+// thread; index() only once indexed() is true.
+// ============================================================================
+
+class SpatialTimeline {
+public:
+  using Frame = std::shared_ptr<const std::vector<Snapshot>>;
+
+  SpatialTimeline(const std::string &path, size_t cacheBytes)
+      : file(path), cacheLimit(cacheBytes) {
+    worker = std::thread([this] { run(); });
+  }
+  ~SpatialTimeline() {
+    stopScan = true;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+  }
+  SpatialTimeline(const SpatialTimeline &) = delete;
+  SpatialTimeline &operator=(const SpatialTimeline &) = delete;
+
+  bool ok() const { return file.ok(); }
+  bool indexed() const { return ready.load(std::memory_order_acquire); }
+  const SpatialIndex &index() const { return idx; }
+
+  // Fraction of the file indexed so far
+  double progress() const {
+    return file.size() ? static_cast<double>(bytesDone.load()) / file.size()
+                       : 1.0;
+  }
+
+  // Rows of step t through the cache
+  Frame frame(int t) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = cache.find(t);
+      if (it != cache.end()) {
+        lru.splice(lru.begin(), lru, it->second.pos);
+        return it->second.rows;
+      }
+    }
+    auto rows = std::make_shared<const std::vector<Snapshot>>(readFrame(t));
+    if (rows->empty())
+      return rows;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(t);
+    if (it != cache.end())
+      return it->second.rows; // Loaded meanwhile by the other thread
+    size_t bytes = rows->capacity() * sizeof(Snapshot);
+    lru.push_front(t);
+    cache[t] = {rows, lru.begin(), bytes};
+    cached += bytes;
+    while (cached > cacheLimit && lru.size() > 1) {
+      auto victim = cache.find(lru.back());
+      cached -= victim->second.bytes;
+      cache.erase(victim);
+      lru.pop_back();
+    }
+    return rows;
+  }
+
+  // Rows of step t parsed straight from the mapping, bypassing the cache
+  std::vector<Snapshot> readFrame(int t) const {
+    std::vector<Snapshot> rows;
+    if (!indexed())
+      return rows;
+    auto range = std::equal_range(
+        idx.frames.begin(), idx.frames.end(), FrameExtent{t, 0, 0, 0},
+        [](const FrameExtent &a, const FrameExtent &b) {
+          return a.time < b.time;
+        });
+    size_t total = 0;
+    for (auto e = range.first; e != range.second; ++e)
+      total += e->rows;
+    rows.reserve(total);
+    for (auto e = range.first; e != range.second; ++e) {
+      const char *p = file.data() + e->begin;
+      const char *end = file.data() + e->end;
+      int time = 0;
+      Snapshot s;
+      while (p < end)
+        if (parseSpatialRow(p, end, time, s))
+          rows.push_back(s);
+    }
+    return rows;
+  }
+
+  // Ask the background thread to load steps [from, from + count); a new
+  // request replaces one still in progress
+  void prefetch(int from, int count) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (prefetchFrom == from && prefetchCount == count)
+        return;
+      prefetchFrom = from;
+      prefetchCount = count;
+      request++;
+    }
+    wake.notify_one();
+  }
+
+  size_t cachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached;
+  }
+
+private:
+  struct Entry {
+    Frame rows;
+    std::list<int>::iterator pos;
+    size_t bytes;
+  };
+
+  void run() {
+    idx = buildSpatialIndex(file, bytesDone, stopScan);
+    ready.store(true, std::memory_order_release);
+    uint64_t served = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait(lock, [&] { return stopping || request != served; });
+      if (stopping)
+        return;
+      served = request;
+      int from = prefetchFrom, count = prefetchCount;
+      lock.unlock();
+      for (int t = from; t < from + count && t <= idx.maxTime; ++t) {
+        {
+          std::lock_guard<std::mutex> check(mutex);
+          if (stopping || request != served)
+            break;
+        }
+        frame(t);
+      }
+      lock.lock();
+    }
+  }
+
+  MappedFile file;
+  SpatialIndex idx;
+  std::atomic<size_t> bytesDone{0};
+  std::atomic<bool> ready{false};
+  std::atomic<bool> stopScan{false};
+
+  mutable std::mutex mutex;
+  std::condition_variable wake;
+  std::unordered_map<int, Entry> cache;
+  std::list<int> lru; // Most recently used first
+  size_t cached = 0;
+  size_t cacheLimit;
+  bool stopping = false;
+  uint64_t request = 0;
+  int prefetchFrom = 0;
+  int prefetchCount = 0;
+
+  std::thread worker;
+};
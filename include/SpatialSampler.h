@@ -0,0 +1,182 @@
+#pragma once
+
+#include "City.h"
+#include "CounterRng.h"
+#include "StateLedger.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// SPATIAL SAMPLING
+// Output policies for spatial_data.csv that bound its size independently
+// of the population. When either is on, each spatial record writes, per
+// claim, the union of:
+//   panel      spatial_panel_size agents chosen once and written at every
+//              record in every state (whole trajectories). With strata the
+//              panel is split over towns or demographic cells in
+//              proportion to their size (largest remainder)
+//   reservoir  spatial_reservoir_size further agents drawn uniformly, at
+//              every record, from the rows the snapshot would otherwise
+//              write (all agents, or the non-Susceptible ones)
+// Selection uses its own CounterRng streams keyed by the run seed and the
+// agent's generation-order ID (plus the step for the reservoir). It is
+// deterministic for a seed, leaves the simulation's draws untouched and
+// does not depend on reorder_agents. The reservoir is a bottom-k sample:
+// every candidate gets a uniform key and the k smallest keys win. A
+// bounded max-heap finds them in one pass, and partitioned runs can merge
+// per-worker samples into exactly the same rows.
+// ============================================================================
+
+enum class PanelStrata { NONE = 0, TOWN = 1, DEMOGRAPHIC = 2 };
+
+class SpatialSampler {
+public:
+  using Key = std::pair<uint64_t, int>; // (uniform key, external ID)
+
+  // Choose the panel for the city's agents (indexed by current ID) and
+  // size the reservoir heap, so that select() does not allocate
+  void configure(int panelSize, PanelStrata strata, int reservoirSize,
+                 unsigned int seed, const City &city) {
+    runSeed = seed;
+    reservoir = static_cast<size_t>(std::max(0, reservoirSize));
+    heap.clear();
+    heap.reserve(std::min(reservoir, city.agents.size()));
+    drawn.reserve(heap.capacity());
+    size_t n = city.agents.size();
+    size_t k = std::min(n, static_cast<size_t>(std::max(0, panelSize)));
+    panel.assign(n, 0);
+    panelIds.clear();
+    if (k == 0)
+      return;
+
+    struct Entry {
+      int stratum;
+      Key key;
+      int id;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(n);
+    for (const auto &agent : city.agents) {
+      int stratum = 0;
+      if (strata == PanelStrata::TOWN)
+        stratum = agent.homeTownId;
+      else if (strata == PanelStrata::DEMOGRAPHIC)
+        stratum = demographicCell(agent.ethnicity, agent.denomination,
+                                  agent.getAgeGroup());
+      entries.push_back({stratum, key(-1, city.externalId(agent.id)),
+                         agent.id});
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) {
+                return a.stratum != b.stratum ? a.stratum < b.stratum
+                                              : a.key < b.key;
+              });
+
+    // Proportional quotas: floors first, then the leftover seats go to the
+    // largest remainders (lower stratum first on ties)
+    struct Group {
+      size_t begin, size, quota;
+      uint64_t remainder;
+    };
+    std::vector<Group> groups;
+    for (size_t i = 0; i < n;) {
+      size_t j = i;
+      while (j < n && entries[j].stratum == entries[i].stratum)
+        ++j;
+      uint64_t share = static_cast<uint64_t>(k) * (j - i);
+      groups.push_back({i, j - i, static_cast<size_t>(share / n), share % n});
+      i = j;
+    }
+    size_t given = 0;
+    for (const Group &g : groups)
+      given += g.quota;
+    std::vector<size_t> order(groups.size());
+    for (size_t g = 0; g < order.size(); ++g)
+      order[g] = g;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return groups[a].remainder > groups[b].remainder;
+    });
+    for (size_t g = 0; given < k; ++g, ++given)
+      groups[order[g]].quota++;
+
+    for (const Group &g : groups) {
+      for (size_t i = g.begin; i < g.begin + g.quota; ++i) {
+        panel[entries[i].id] = 1;
+        panelIds.push_back(entries[i].id);
+      }
+    }
+    std::sort(panelIds.begin(), panelIds.end());
+  }
+
+  bool active() const { return !panelIds.empty() || reservoir > 0; }
+  bool usesReservoir() const { return reservoir > 0; }
+  size_t reservoirSize() const { return reservoir; }
+  bool inPanel(int id) const { return panel[id] != 0; }
+
+  // Most rows select() returns for one claim: the panel plus the reservoir
+  size_t maxRows() const {
+    return std::min(panel.size(), panelIds.size() + reservoir);
+  }
+
+  // Panel members by current ID, ascending
+  const std::vector<int> &panelAgents() const { return panelIds; }
+
+  // Heap held by the sampler, for the memory report
+  size_t bytes() const {
+    return panel.capacity() + panelIds.capacity() * sizeof(int) +
+           heap.capacity() * sizeof(heap[0]) + drawn.capacity() * sizeof(int);
+  }
+
+  // Sampling key of an agent at a step (step -1 for the panel)
+  Key key(int step, int externalId) const {
+    CounterRng stream;
+    stream.seed(runSeed ^ SAMPLE_SALT, step, -1, externalId);
+    return {stream(), externalId};
+  }
+
+  // Rows to write for one claim, ascending: the given panel members plus
+  // the bottom-k of the non-panel candidates passed to offer() by
+  // forEachCandidate(offer)
+  template <typename ForEachCandidate, typename ExternalId>
+  void select(int step, const std::vector<int> &panelRows,
+              ForEachCandidate forEachCandidate, ExternalId externalId,
+              std::vector<int> &out) {
+    heap.clear();
+    if (reservoir > 0) {
+      forEachCandidate([&](int id) {
+        if (panel[id])
+          return;
+        std::pair<Key, int> item{key(step, externalId(id)), id};
+        if (heap.size() < reservoir) {
+          heap.push_back(item);
+          std::push_heap(heap.begin(), heap.end());
+        } else if (item < heap.front()) {
+          std::pop_heap(heap.begin(), heap.end());
+          heap.back() = item;
+          std::push_heap(heap.begin(), heap.end());
+        }
+      });
+    }
+    // Merge through a reserved list: std::inplace_merge would allocate
+    drawn.clear();
+    for (const auto &item : heap)
+      drawn.push_back(item.second);
+    std::sort(drawn.begin(), drawn.end());
+    out.clear();
+    std::merge(panelRows.begin(), panelRows.end(), drawn.begin(), drawn.end(),
+               std::back_inserter(out));
+  }
+
+private:
+  static constexpr uint64_t SAMPLE_SALT = 0x53414d504c450000ULL; // "SAMPLE"
+
+  unsigned int runSeed = 0;
+  size_t reservoir = 0;
+  std::vector<char> panel; // Per agent (current ID)
+  std::vector<int> panelIds;
+  std::vector<std::pair<Key, int>> heap; // Max-heap of the k smallest keys
+  std::vector<int> drawn;                // Reservoir rows, sorted
+};
@@ -0,0 +1,376 @@
+#pragma once
+
+#include "Demographics.h"
+#include "SEDPNR.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// STATE COUNTS
+// Number of agents in each SEDPNR state for one claim
+// ============================================================================
+
+struct StateCounts {
+  int susceptible = 0;
+  int exposed = 0;
+  int doubtful = 0;
+  int propagating = 0;
+  int notSpreading = 0;
+  int recovered = 0;
+
+  int total() const {
+    return susceptible + exposed + doubtful + propagating + notSpreading +
+           recovered;
+  }
+
+  void add(SEDPNRState state, int delta = 1) {
+    switch (state) {
+    case SEDPNRState::SUSCEPTIBLE:
+      susceptible += delta;
+      break;
+    case SEDPNRState::EXPOSED:
+      exposed += delta;
+      break;
+    case SEDPNRState::DOUBTFUL:
+      doubtful += delta;
+      break;
+    case SEDPNRState::PROPAGATING:
+      propagating += delta;
+      break;
+    case SEDPNRState::NOT_SPREADING:
+      notSpreading += delta;
+      break;
+    case SEDPNRState::RECOVERED:
+      recovered += delta;
+      break;
+    default:
+      break;
+    }
+  }
+
+  void add(const StateCounts &other) {
+    susceptible += other.susceptible;
+    exposed += other.exposed;
+    doubtful += other.doubtful;
+    propagating += other.propagating;
+    notSpreading += other.notSpreading;
+    recovered += other.recovered;
+  }
+};
+
+// ============================================================================
+// TRANSITION FLOWS
+// 6x6 matrix of agents moving from one state to another, indexed
+// [from * NUM_FLOW_STATES + to]; the diagonal stays zero
+// ============================================================================
+
+constexpr int NUM_FLOW_STATES = static_cast<int>(SEDPNRState::NUM_STATES);
+using FlowMatrix = std::array<int, NUM_FLOW_STATES * NUM_FLOW_STATES>;
+
+inline int flowIndex(SEDPNRState from, SEDPNRState to) {
+  return static_cast<int>(from) * NUM_FLOW_STATES + static_cast<int>(to);
+}
+
+inline void addFlows(FlowMatrix &into, const FlowMatrix &from) {
+  for (size_t i = 0; i < into.size(); ++i)
+    into[i] += from[i];
+}
+
+// ============================================================================
+// STATE LEDGER
+// Per-claim state counts and transition flows, updated on every applied
+// state change so that recording a step costs O(claims) instead of a scan
+// of the population. Flows accumulate until takeFlows(). Claims are
+// indexed as in Simulation::claims.
+// ============================================================================
+
+class StateLedger {
+public:
+  void clear() {
+    counts.clear();
+    flows.clear();
+  }
+
+  // Track one more claim, starting from its current counts
+  void addClaim(const StateCounts &initial) {
+    counts.push_back(initial);
+    flows.push_back(FlowMatrix{});
+  }
+
+  size_t size() const { return counts.size(); }
+
+  // Record one agent's change of state for claim c
+  void move(size_t c, SEDPNRState from, SEDPNRState to) {
+    if (from == to)
+      return;
+    counts[c].add(from, -1);
+    counts[c].add(to, 1);
+    flows[c][flowIndex(from, to)]++;
+  }
+
+  const StateCounts &current(size_t c) const { return counts[c]; }
+  const FlowMatrix &pendingFlows(size_t c) const { return flows[c]; }
+
+  // Flows since the last call, then start a new interval
+  FlowMatrix takeFlows(size_t c) {
+    FlowMatrix out = flows[c];
+    flows[c].fill(0);
+    return out;
+  }
+
+  size_t bytes() const {
+    return counts.capacity() * sizeof(StateCounts) +
+           flows.capacity() * sizeof(FlowMatrix);
+  }
+
+private:
+  std::vector<StateCounts> counts;
+  std::vector<FlowMatrix> flows;
+};
+
+// ============================================================================
+// DIRTY SLOTS
+// Slots of a ledger whose counts changed since the last take(), listed
+// once each. New slots start marked, so a claim's first record writes
+// them all.
+// ============================================================================
+
+class DirtySlots {
+public:
+  void clear() {
+    dirty.clear();
+    dirtyList.clear();
+    taken.clear();
+  }
+
+  // Track n more slots, all marked
+  void grow(size_t n) {
+    size_t first = dirty.size();
+    dirty.resize(first + n, 1);
+    // A slot is listed at most once, so the lists never outgrow dirty
+    // and mark() does not allocate
+    dirtyList.reserve(dirty.size());
+    taken.reserve(dirty.size());
+    for (size_t slot = first; slot < dirty.size(); ++slot)
+      dirtyList.push_back(slot);
+  }
+
+  void mark(size_t slot) {
+    if (!dirty[slot]) {
+      dirty[slot] = 1;
+      dirtyList.push_back(slot);
+    }
+  }
+
+  // Slots marked since the last call, ascending
+  const std::vector<size_t> &take() {
+    std::sort(dirtyList.begin(), dirtyList.end());
+    for (size_t slot : dirtyList)
+      dirty[slot] = 0;
+    taken.swap(dirtyList);
+    dirtyList.clear();
+    return taken;
+  }
+
+  size_t bytes() const {
+    return dirty.capacity() +
+           (dirtyList.capacity() + taken.capacity()) * sizeof(size_t);
+  }
+
+private:
+  std::vector<char> dirty;
+  std::vector<size_t> dirtyList;
+  std::vector<size_t> taken;
+};
+
+// ============================================================================
+// LOCAL LEDGER
+// Per-claim state counts for every town and every location (school,
+// religious site, workplace), updated on each applied state change. Units
+// are numbered towns first, then locations by dense location ID. Units
+// whose counts changed since the last takeDirty() are tracked so that a
+// record only writes what moved; a newly added claim marks every unit.
+// ============================================================================
+
+class LocalLedger {
+public:
+  void reset(size_t towns, size_t locations) {
+    numTowns = towns;
+    numUnits = towns + locations;
+    counts.clear();
+    changed.clear();
+  }
+
+  bool empty() const { return numUnits == 0; }
+  size_t units() const { return numUnits; }
+  size_t townCount() const { return numTowns; }
+
+  // Track one more claim with zero counts; fill it with count()
+  void addClaim() {
+    counts.resize(counts.size() + numUnits);
+    changed.grow(numUnits);
+  }
+
+  // Add an agent in a given state to its town and locations
+  template <typename AgentT>
+  void count(size_t c, const AgentT &agent, SEDPNRState state) {
+    forUnits(agent, [&](size_t u) {
+      counts[c * numUnits + u].add(state);
+    });
+  }
+
+  // Record one agent's change of state for claim c
+  template <typename AgentT>
+  void move(size_t c, const AgentT &agent, SEDPNRState from, SEDPNRState to) {
+    if (from == to)
+      return;
+    forUnits(agent, [&](size_t u) {
+      size_t slot = c * numUnits + u;
+      counts[slot].add(from, -1);
+      counts[slot].add(to, 1);
+      changed.mark(slot);
+    });
+  }
+
+  const StateCounts &at(size_t c, size_t unit) const {
+    return counts[c * numUnits + unit];
+  }
+
+  // Slots (claim * units + unit) changed since the last call, ascending
+  const std::vector<size_t> &takeDirty() { return changed.take(); }
+
+  size_t bytes() const {
+    return counts.capacity() * sizeof(StateCounts) + changed.bytes();
+  }
+
+private:
+  template <typename AgentT, typename Fn>
+  void forUnits(const AgentT &agent, Fn &&fn) const {
+    fn(static_cast<size_t>(agent.homeTownId));
+    for (int loc : {agent.schoolLocationId, agent.religiousLocationId,
+                    agent.workplaceLocationId}) {
+      if (loc >= 0)
+        fn(numTowns + static_cast<size_t>(loc));
+    }
+  }
+
+  size_t numTowns = 0;
+  size_t numUnits = 0;
+  std::vector<StateCounts> counts; // [claim * units + unit]
+  DirtySlots changed;
+};
+
+// ============================================================================
+// DEMOGRAPHIC LEDGER
+// Per-claim state counts for every (ethnicity, denomination, age group)
+// cell, plus the number of distinct agents of each cell that have ever
+// left Susceptible, updated on each applied state change. Demographics do
+// not change during a run, so one bit per agent and claim records "ever
+// infected" exactly: a cell's count grows when one of its agents' bits is
+// first set, and no per-cell sets or sketches are needed. Cells that
+// changed since the last takeDirty() are tracked as in LocalLedger.
+// ============================================================================
+
+constexpr int NUM_ETHNIC_CELLS = static_cast<int>(EthnicGroup::NUM_GROUPS);
+constexpr int NUM_DENOMINATION_CELLS =
+    static_cast<int>(ReligiousDenomination::NUM_DENOMINATIONS);
+constexpr int NUM_AGE_CELLS = static_cast<int>(AgeGroup::NUM_GROUPS);
+constexpr int NUM_DEMOGRAPHIC_CELLS =
+    NUM_ETHNIC_CELLS * NUM_DENOMINATION_CELLS * NUM_AGE_CELLS;
+
+// Cell index, ethnicity-major
+inline int demographicCell(EthnicGroup eth, ReligiousDenomination denom,
+                           AgeGroup age) {
+  return (static_cast<int>(eth) * NUM_DENOMINATION_CELLS +
+          static_cast<int>(denom)) *
+             NUM_AGE_CELLS +
+         static_cast<int>(age);
+}
+
+class DemographicLedger {
+public:
+  // Assign every agent (by index) to its cell; drops all claims
+  template <typename AgentT> void reset(const std::vector<AgentT> &agents) {
+    cellOf.resize(agents.size());
+    for (size_t i = 0; i < agents.size(); ++i)
+      cellOf[i] = static_cast<uint16_t>(demographicCell(
+          agents[i].ethnicity, agents[i].denomination,
+          agents[i].getAgeGroup()));
+    counts.clear();
+    ever.clear();
+    everBits.clear();
+    changed.clear();
+    active = true;
+  }
+
+  bool empty() const { return !active; }
+  size_t claimCount() const { return ever.size() / NUM_DEMOGRAPHIC_CELLS; }
+
+  // Track one more claim with zero counts; fill it with count()
+  void addClaim() {
+    counts.resize(counts.size() + NUM_DEMOGRAPHIC_CELLS);
+    ever.resize(ever.size() + NUM_DEMOGRAPHIC_CELLS, 0);
+    everBits.resize(everBits.size() + words());
+    changed.grow(NUM_DEMOGRAPHIC_CELLS);
+  }
+
+  // Add agent i in a given state to claim c
+  void count(size_t c, size_t i, SEDPNRState state) {
+    size_t slot = c * NUM_DEMOGRAPHIC_CELLS + cellOf[i];
+    counts[slot].add(state);
+    changed.mark(slot);
+    if (state != SEDPNRState::SUSCEPTIBLE)
+      markInfected(c, i);
+  }
+
+  // Record agent i's change of state for claim c
+  void move(size_t c, size_t i, SEDPNRState from, SEDPNRState to) {
+    if (from == to)
+      return;
+    size_t slot = c * NUM_DEMOGRAPHIC_CELLS + cellOf[i];
+    counts[slot].add(from, -1);
+    counts[slot].add(to, 1);
+    changed.mark(slot);
+    if (to != SEDPNRState::SUSCEPTIBLE)
+      markInfected(c, i);
+  }
+
+  const StateCounts &at(size_t c, int cell) const {
+    return counts[c * NUM_DEMOGRAPHIC_CELLS + cell];
+  }
+  int everInfected(size_t c, int cell) const {
+    return ever[c * NUM_DEMOGRAPHIC_CELLS + cell];
+  }
+
+  // Slots (claim * cells + cell) changed since the last call, ascending
+  const std::vector<size_t> &takeDirty() { return changed.take(); }
+
+  size_t bytes() const {
+    return counts.capacity() * sizeof(StateCounts) +
+           ever.capacity() * sizeof(int) +
+           everBits.capacity() * sizeof(uint64_t) +
+           cellOf.capacity() * sizeof(uint16_t) + changed.bytes();
+  }
+
+private:
+  size_t words() const { return (cellOf.size() + 63) / 64; }
+
+  void markInfected(size_t c, size_t i) {
+    uint64_t &word = everBits[c * words() + i / 64];
+    uint64_t bit = uint64_t(1) << (i % 64);
+    if (!(word & bit)) {
+      word |= bit;
+      ever[c * NUM_DEMOGRAPHIC_CELLS + cellOf[i]]++;
+    }
+  }
+
+  bool active = false;
+  std::vector<uint16_t> cellOf;     // Per agent index
+  std::vector<StateCounts> counts;  // [claim * cells + cell]
+  std::vector<int> ever;            // [claim * cells + cell]
+  std::vector<uint64_t> everBits;   // [claim * words + agent / 64]
+  DirtySlots changed;
+};
@@ -1,35 +1,41 @@
 #pragma once
 #include "Demographics.h"
-#include "Location.h"
-#include <random>
+#include "LocationRegistry.h"
+#include <memory_resource>
 #include <string>
 #include <vector>
 
 // ============================================================================
 // TOWN STRUCTURE
-// Represents a town containing schools and religious establishments
+// Represents a town containing schools and religious establishments.
+// Locations themselves live in City's LocationRegistry; a town keeps the
+// dense IDs of its own sites.
 // ============================================================================
 
 struct Town {
   int id;
   std::string name;
-  std::vector<Location> schools;
-  std::vector<Location> religiousEstablishments;
-  std::vector<Location> workplaces;
+  std::vector<int> schools;
+  std::vector<int> religiousEstablishments;
+  std::vector<int> workplaces;
 
   Town() : id(-1) {}
 
+  // Registers the town's locations (names and member lists allocate from
+  // mem)
   Town(int townId, int numSchools, int numReligious, int numWorkplaces,
-       int schoolCap, int religiousCap, int workplaceCap)
+       int schoolCap, int religiousCap, int workplaceCap,
+       LocationRegistry &registry,
+       std::pmr::memory_resource *mem = std::pmr::get_default_resource())
       : id(townId) {
     name = "Town_" + std::to_string(townId);
 
     // Create schools
     for (int i = 0; i < numSchools; ++i) {
-      int locId = townId * 1000 + i; // Unique ID scheme
       std::string locName = name + "_School_" + std::to_string(i);
-      schools.emplace_back(locId, LocationType::SCHOOL, townId, locName,
-                           schoolCap);
+      schools.push_back(registry.add(LocationType::SCHOOL, townId, locName,
+                                     schoolCap, ReligiousDenomination::NONE,
+                                     mem));
     }
 
     // Create religious establishments
@@ -37,8 +43,6 @@ struct Town {
     int numReligiousDenoms =
         static_cast<int>(ReligiousDenomination::NUM_DENOMINATIONS) - 1;
     for (int i = 0; i < numReligious; ++i) {
-      int locId = townId * 1000 + 100 + i;
-
       ReligiousDenomination denom;
       if (i < numReligiousDenoms) {
         // One of each first
@@ -49,89 +53,19 @@ struct Town {
             static_cast<ReligiousDenomination>((i % numReligiousDenoms) + 1);
       }
 
-      std::string denomName;
-      switch (denom) {
-      case ReligiousDenomination::CATHOLIC:
-        denomName = "Catholic";
-        break;
-      case ReligiousDenomination::EVANGELICAL:
-        denomName = "Evangelical";
-        break;
-      case ReligiousDenomination::MAINLINE:
-        denomName = "Mainline";
-        break;
-      case ReligiousDenomination::LDS:
-        denomName = "LDS";
-        break;
-      case ReligiousDenomination::JEWISH:
-        denomName = "Jewish";
-        break;
-      case ReligiousDenomination::MUSLIM:
-        denomName = "Muslim";
-        break;
-      case ReligiousDenomination::BUDDHIST:
-        denomName = "Buddhist";
-        break;
-      case ReligiousDenomination::HINDU:
-        denomName = "Hindu";
-        break;
-      default:
-        denomName = "Other";
-        break;
-      }
-
-      std::string locName = name + "_" + denomName + "_" + std::to_string(i);
-      religiousEstablishments.emplace_back(
-          locId, LocationType::RELIGIOUS_ESTABLISHMENT, townId, locName,
-          religiousCap, denom);
+      std::string locName = name + "_" + denominationToString(denom) + "_" +
+                            std::to_string(i);
+      religiousEstablishments.push_back(
+          registry.add(LocationType::RELIGIOUS_ESTABLISHMENT, townId, locName,
+                       religiousCap, denom, mem));
     }
 
     // Create workplaces
     for (int i = 0; i < numWorkplaces; ++i) {
-      int locId = townId * 1000 + 500 + i;
       std::string locName = name + "_Work_" + std::to_string(i);
-      workplaces.emplace_back(locId, LocationType::WORKPLACE, townId, locName,
-                              workplaceCap);
+      workplaces.push_back(registry.add(LocationType::WORKPLACE, townId,
+                                        locName, workplaceCap,
+                                        ReligiousDenomination::NONE, mem));
     }
   }
-
-  // Get a random school location
-  Location *getRandomSchool(std::mt19937 &rng) {
-    if (schools.empty())
-      return nullptr;
-    std::uniform_int_distribution<size_t> dist(0, schools.size() - 1);
-    return &schools[dist(rng)];
-  }
-
-  // Get a random religious establishment
-  Location *getRandomReligious(std::mt19937 &rng) {
-    if (religiousEstablishments.empty())
-      return nullptr;
-    std::uniform_int_distribution<size_t> dist(
-        0, religiousEstablishments.size() - 1);
-    return &religiousEstablishments[dist(rng)];
-  }
-
-  // Get a random religious establishment of a specific denomination
-  Location *getRandomReligiousOfDenomination(std::mt19937 &rng,
-                                             ReligiousDenomination denom) {
-    std::vector<Location *> matches;
-    for (auto &loc : religiousEstablishments) {
-      if (loc.denomination == denom) {
-        matches.push_back(&loc);
-      }
-    }
-    if (matches.empty())
-      return nullptr;
-    std::uniform_int_distribution<size_t> dist(0, matches.size() - 1);
-    return matches[dist(rng)];
-  }
-
-  // Get a random workplace
-  Location *getRandomWorkplace(std::mt19937 &rng) {
-    if (workplaces.empty())
-      return nullptr;
-    std::uniform_int_distribution<size_t> dist(0, workplaces.size() - 1);
-    return &workplaces[dist(rng)];
-  }
 };
@@ -0,0 +1,241 @@
+// ============================================================================
+// SEDPNR Demographic Analysis
+// Native replacement for analyze.py: distinct infected agents per claim,
+// ethnicity and denomination, plus how long agents take to adopt each claim
+// ============================================================================
+
+#include "../include/SEDPNR.h"
+#include "../include/SpatialLoader.h"
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// CHUNK STATISTICS
+// The dump is mapped and split into one chunk per thread on newline
+// boundaries. Each chunk keeps, per (claim, ethnicity, denomination) cell,
+// a bitset over agent IDs of the agents seen outside state S, and per claim
+// the first step it appears and the first step each agent adopts it (P or
+// N; R means rejected or recovered, not adopted). Chunks are merged in file
+// order: cells keep the order they first appear in, bitsets are OR'd and
+// first steps take the minimum.
+// ============================================================================
+
+using Bitset = std::vector<uint64_t>;
+
+inline uint64_t cellKey(int claim, int ethnicity, int denomination) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(claim)) << 32) |
+         (static_cast<uint64_t>(static_cast<uint16_t>(ethnicity)) << 16) |
+         static_cast<uint16_t>(denomination);
+}
+
+inline void setBit(Bitset &bits, int id) {
+  size_t word = static_cast<size_t>(id) / 64;
+  if (word >= bits.size())
+    bits.resize(word + 1, 0);
+  bits[word] |= uint64_t(1) << (id % 64);
+}
+
+inline size_t popcount(const Bitset &bits) {
+  size_t n = 0;
+  for (uint64_t w : bits)
+    n += static_cast<size_t>(__builtin_popcountll(w));
+  return n;
+}
+
+struct ClaimTimes {
+  int start = INT_MAX;         // First step with a row for the claim
+  std::vector<int> adoptedAt; // [agent], INT_MAX if never adopted
+};
+
+struct ChunkStats {
+  std::unordered_map<uint64_t, size_t> cellSlot;
+  std::vector<uint64_t> cellKeys; // In order of first appearance
+  std::vector<Bitset> cellAgents;
+  std::map<int, ClaimTimes> claims;
+  size_t rows = 0;
+};
+
+void scanChunk(const char *p, const char *end, ChunkStats &out) {
+  uint64_t lastKey = ~uint64_t(0);
+  Bitset *lastCell = nullptr;
+  int lastClaim = INT_MIN;
+  ClaimTimes *claim = nullptr;
+  while (p < end) {
+    int time = 0;
+    Snapshot s;
+    if (!parseSpatialRow(p, end, time, s) || s.agentId < 0)
+      continue;
+    out.rows++;
+    if (s.claimId != lastClaim) {
+      claim = &out.claims[s.claimId];
+      lastClaim = s.claimId;
+    }
+    claim->start = std::min(claim->start, time);
+    if (s.state == 0)
+      continue;
+
+    uint64_t key = cellKey(s.claimId, s.ethnicity, s.denomination);
+    if (key != lastKey) {
+      auto [it, added] = out.cellSlot.emplace(key, out.cellKeys.size());
+      if (added) {
+        out.cellKeys.push_back(key);
+        out.cellAgents.emplace_back();
+      }
+      lastCell = &out.cellAgents[it->second];
+      lastKey = key;
+    }
+    setBit(*lastCell, s.agentId);
+
+    if (s.state == static_cast<int>(SEDPNRState::PROPAGATING) ||
+        s.state == static_cast<int>(SEDPNRState::NOT_SPREADING)) {
+      auto &at = claim->adoptedAt;
+      if (static_cast<size_t>(s.agentId) >= at.size())
+        at.resize(static_cast<size_t>(s.agentId) + 1, INT_MAX);
+      at[s.agentId] = std::min(at[s.agentId], time);
+    }
+  }
+}
+
+void merge(ChunkStats &into, ChunkStats &chunk) {
+  for (size_t k = 0; k < chunk.cellKeys.size(); ++k) {
+    auto [it, added] =
+        into.cellSlot.emplace(chunk.cellKeys[k], into.cellKeys.size());
+    if (added) {
+      into.cellKeys.push_back(chunk.cellKeys[k]);
+      into.cellAgents.push_back(std::move(chunk.cellAgents[k]));
+      continue;
+    }
+    Bitset &bits = into.cellAgents[it->second];
+    const Bitset &other = chunk.cellAgents[k];
+    if (other.size() > bits.size())
+      bits.resize(other.size(), 0);
+    for (size_t w = 0; w < other.size(); ++w)
+      bits[w] |= other[w];
+  }
+  for (auto &[claimId, times] : chunk.claims) {
+    ClaimTimes &c = into.claims[claimId];
+    c.start = std::min(c.start, times.start);
+    if (times.adoptedAt.size() > c.adoptedAt.size())
+      c.adoptedAt.resize(times.adoptedAt.size(), INT_MAX);
+    for (size_t a = 0; a < times.adoptedAt.size(); ++a)
+      c.adoptedAt[a] = std::min(c.adoptedAt[a], times.adoptedAt[a]);
+  }
+  into.rows += chunk.rows;
+}
+
+// ============================================================================
+// MAIN FUNCTION
+// ============================================================================
+
+int main(int argc, char *argv[]) {
+  std::string path = "output/spatial_data.csv";
+  std::string delaysPath = "output/adoption_times.csv";
+  size_t threads = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    else
+      path = argv[i];
+  }
+
+  // The opening line and the demographics section match analyze.py
+  std::cout << "Analyzing demographics of infected agents..." << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  MappedFile file(path);
+  if (!file.ok()) {
+    std::cout << "Error: cannot read " << path << std::endl;
+    return 1;
+  }
+  const char *end = file.data() + file.size();
+  std::vector<const char *> cuts =
+      splitAtLines(skipHeaderLine(file.data(), end), end, threads);
+  std::vector<ChunkStats> chunks(cuts.size() - 1);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < chunks.size(); ++i)
+    workers.emplace_back(
+        [&, i] { scanChunk(cuts[i], cuts[i + 1], chunks[i]); });
+  for (auto &w : workers)
+    w.join();
+  ChunkStats total = std::move(chunks[0]);
+  for (size_t i = 1; i < chunks.size(); ++i)
+    merge(total, chunks[i]);
+
+  std::cout << "\n--- Demographics of Infected/Recovered Agents ---"
+            << std::endl;
+  const char *ethNames[] = {"White", "Hispanic", "Black",
+                            "Asian", "Native",   "Multi"};
+  for (size_t k = 0; k < total.cellKeys.size(); ++k) {
+    uint64_t key = total.cellKeys[k];
+    int claim = static_cast<int32_t>(key >> 32);
+    int eth = static_cast<int16_t>((key >> 16) & 0xFFFF);
+    int den = static_cast<int16_t>(key & 0xFFFF);
+    size_t count = popcount(total.cellAgents[k]);
+    if (count <= 10) // Only print significant clusters
+      continue;
+    std::cout << "Claim " << claim << ", Eth "
+              << (eth >= 0 && eth < 6 ? ethNames[eth] : std::to_string(eth))
+              << ", Denom " << den << ": " << count << " unique agents"
+              << std::endl;
+  }
+
+  // Steps from a claim's first appearance to each agent's adoption
+  std::cout << "\n--- Time to Adoption (steps after the claim appears) ---"
+            << std::endl;
+  std::ofstream delays(delaysPath);
+  delays << "ClaimId,Steps,Agents\n";
+  for (const auto &[claimId, times] : total.claims) {
+    std::map<int, size_t> histogram;
+    size_t adopters = 0;
+    double sum = 0;
+    for (int t : times.adoptedAt) {
+      if (t == INT_MAX)
+        continue;
+      histogram[t - times.start]++;
+      adopters++;
+      sum += t - times.start;
+    }
+    for (const auto &[steps, agents] : histogram)
+      delays << claimId << "," << steps << "," << agents << "\n";
+    if (adopters == 0) {
+      std::cout << "Claim " << claimId << ": no adopters" << std::endl;
+      continue;
+    }
+    // Nearest-rank percentiles from the histogram
+    auto percentile = [&](double q) {
+      size_t rank = std::max<size_t>(1, (size_t)std::ceil(q * adopters));
+      size_t seen = 0;
+      for (const auto &[steps, agents] : histogram) {
+        seen += agents;
+        if (seen >= rank)
+          return steps;
+      }
+      return histogram.rbegin()->first;
+    };
+    std::cout << "Claim " << claimId << ": " << adopters
+              << " adopters, mean " << std::fixed << std::setprecision(1)
+              << sum / adopters << std::defaultfloat << ", p10 "
+              << percentile(0.1) << ", median " << percentile(0.5)
+              << ", p90 " << percentile(0.9) << ", max "
+              << histogram.rbegin()->first << std::endl;
+  }
+
+  double secs =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cerr << "Analyzed " << total.rows << " rows in " << secs << " s ("
+            << chunks.size() << " threads); histograms in " << delaysPath
+            << std::endl;
+  return 0;
+}
@@ -3,6 +3,8 @@
 // Main Entry Point
 // ============================================================================
 
+#include "../include/AllocCounter.h"
+#include "../include/PartitionedRun.h"
 #include "../include/Simulation.h"
 #include <iomanip>
 #include <iostream>
@@ -15,6 +17,9 @@
 // MAIN FUNCTION
 // ============================================================================
 
+// Per-step console table rows
+constexpr size_t MAX_CLAIMS_SHOWN = 8;
+
 int main(int argc, char *argv[]) {
   auto &cfg = Configuration::instance();
 
@@ -41,6 +46,11 @@ int main(int argc, char *argv[]) {
   std::cout << "  Time steps:  " << cfg.timesteps << std::endl;
   std::cout << "  Random seed: " << cfg.seed << std::endl;
 
+  // Reject partitioned configs before building the city
+  if (cfg.partitions > 1 &&
+      !PartitionedRun::supports(SimParams::compile(cfg)))
+    return 1;
+
   // Create simulation
   Simulation sim(cfg.seed);
 
@@ -49,6 +59,14 @@ int main(int argc, char *argv[]) {
 
   std::cout << "City generated with " << sim.city.getPopulationSize()
             << " agents" << std::endl;
+  if (sim.params.reorder_agents) {
+    const ReorderStats &reorder = sim.reorderStats;
+    std::cout << "Agent reordering: mean neighbour ID distance "
+              << reorder.meanDistanceBefore << " -> "
+              << reorder.meanDistanceAfter
+              << (reorder.applied ? "" : " (kept current order)") << std::endl;
+  }
+  sim.printMemoryReport("after initialize()");
 
   // Add claims
   std::cout << "\nAdding claims..." << std::endl;
@@ -65,15 +83,52 @@ int main(int argc, char *argv[]) {
   std::cout << "  Added: " << misinfo1.name
             << " (Misinformation) with 5 propagators per district" << std::endl;
 
+  // News cycle: many small competing claims, alternating stance
+  for (int k = 0; k < cfg.news_cycle_claims; ++k) {
+    int id = 2 + k;
+    Claim extra = (k % 2 == 0) ? Claim::createMisinformation(id)
+                               : Claim::createTruth(id);
+    sim.addClaim(extra, cfg.news_cycle_seeds);
+  }
+  if (cfg.news_cycle_claims > 0) {
+    std::cout << "  Added: " << cfg.news_cycle_claims
+              << " news-cycle claims with " << cfg.news_cycle_seeds
+              << " initial propagators each" << std::endl;
+  }
+
   // Run simulation
   std::cout << "\nRunning controllable simulation..." << std::endl;
   std::cout
       << "Controls: [Enter] to step, [R] to run continuously, [P] to pause"
       << std::endl;
 
+  PROFILE_RESERVE(cfg.timesteps, sim.claims.size());
+
+  // Heap allocations made inside step() (counted with COUNT_ALLOCS=1);
+  // the first step is warm-up, later steps should not allocate. Arena
+  // block growth is counted apart: it is geometric, so rare and bounded
+  size_t warmupAllocs = 0, steadyAllocs = 0, arenaGrowth = 0;
+
+  // Town-partitioned run across worker processes (partitions > 1)
+  if (sim.params.partitions > 1) {
+    PartitionedRun partitioned(sim, sim.params.partitions);
+    if (!partitioned.run(cfg.timesteps))
+      return 1;
+  }
+
   bool continuous = true; // Auto-run to completion
-  for (int t = 0; t < cfg.timesteps; ++t) {
+  for (int t = 0; t < cfg.timesteps && sim.params.partitions <= 1; ++t) {
+    size_t allocsBefore = AllocCounter::count();
+    size_t blocksBefore = sim.city.arenaBlocks();
     sim.step();
+    size_t blocks = sim.city.arenaBlocks() - blocksBefore;
+    size_t allocs = AllocCounter::count() - allocsBefore - blocks;
+    if (t == 0) {
+      warmupAllocs += allocs;
+    } else {
+      steadyAllocs += allocs;
+      arenaGrowth += blocks;
+    }
 
     // Print header every 20 steps or at start
     if (t % 20 == 0) {
@@ -86,8 +141,11 @@ int main(int argc, char *argv[]) {
       std::cout << std::string(65, '-') << std::endl;
     }
 
-    // Print stats for each claim
+    // Print stats for each claim (the first few in news-cycle runs)
+    size_t shown = 0;
     for (const auto &claim : sim.claims) {
+      if (shown++ == MAX_CLAIMS_SHOWN)
+        break;
       StateCounts sc = sim.getLatestStateCounts(claim.claimId);
       std::cout << std::setw(6) << t << " | " << std::setw(15)
                 << claim.name.substr(0, 15) << " | " << std::setw(4)
@@ -114,9 +172,33 @@ int main(int argc, char *argv[]) {
   // Output results
   std::cout << "\nWriting results..." << std::endl;
   sim.outputResults("output/simulation_results.csv");
+  sim.outputFlows("output/flows.csv");
+  sim.outputSpatialIndex("output/spatial_data.csv.idx");
+  sim.closeArrowOutputs();
 
   // Print final summary
   sim.outputSummary();
+  sim.printMemoryReport("end of run");
+
+  // Per-phase timing report (no-op unless built with PROFILE=1)
+  PROFILE_REPORT(cfg.profile_step_breakdown);
+
+#ifdef SIM_COUNT_ALLOCS
+  std::cout << "\nHeap allocations in step(): " << warmupAllocs
+            << " in the first step, " << steadyAllocs << " in the remaining "
+            << std::max(0, cfg.timesteps - 1) << " steps (plus "
+            << arenaGrowth << " arena blocks)" << std::endl;
+  // Fail the run so `make check-allocs` catches steady-state allocations
+  if (steadyAllocs > 0) {
+    std::cerr << "Error: steady-state step() allocated " << steadyAllocs
+              << " times" << std::endl;
+    return 1;
+  }
+#else
+  (void)warmupAllocs;
+  (void)steadyAllocs;
+  (void)arenaGrowth;
+#endif
 
   std::cout << "\n=================================================="
             << std::endl;
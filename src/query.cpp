@@ -0,0 +1,182 @@
+// ============================================================================
+// SEDPNR Snapshot Query
+// Answers point and range queries on output/spatial_data.csv through the
+// index the simulation writes next to it (spatial_index=true)
+// ============================================================================
+
+#include "../include/SnapshotStore.h"
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static void usage() {
+  std::cout
+      << "Usage: query [--data PATH] [--claim ID] COMMAND ARGS\n"
+         "  info                          Records, claims and index sizes\n"
+         "  state AGENT TIME              State of an agent at a time\n"
+         "  history AGENT                 State changes of an agent\n"
+         "  location LOC STATE FROM [TO]  Agents of a location in STATE\n"
+         "  town TOWN STATE FROM [TO]     Agents of a town in STATE\n"
+         "  frame TIME                    CSV rows of one record\n"
+         "STATE is S, E, D, P, N, R or 0-5. --claim limits the output to one\n"
+         "claim (default: every claim). PATH defaults to "
+         "output/spatial_data.csv\n";
+}
+
+// "P" or "3" -> 3; -1 if not a state
+static int parseState(const std::string &s) {
+  const char *letters = "SEDPNR";
+  if (s.size() == 1) {
+    const char *at = std::strchr(letters, std::toupper(s[0]));
+    if (at && *at)
+      return static_cast<int>(at - letters);
+    if (s[0] >= '0' && s[0] <= '5')
+      return s[0] - '0';
+  }
+  return -1;
+}
+
+static std::string stateName(int state) {
+  if (state < 0)
+    return "-";
+  return stateToString(static_cast<SEDPNRState>(state));
+}
+
+int main(int argc, char *argv[]) {
+  std::string path = "output/spatial_data.csv";
+  int claimFilter = INT_MIN;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+      path = argv[++i];
+    else if (std::strcmp(argv[i], "--claim") == 0 && i + 1 < argc)
+      claimFilter = std::atoi(argv[++i]);
+    else
+      args.push_back(argv[i]);
+  }
+  if (args.empty()) {
+    usage();
+    return 1;
+  }
+
+  SnapshotStore store(path);
+  if (!store.ok()) {
+    std::cerr << "Error: " << store.error()
+              << " (run the simulation with spatial_index=true)" << std::endl;
+    return 1;
+  }
+  std::vector<int> claimIds;
+  for (const IndexClaim &c : store.claims()) {
+    if (claimFilter == INT_MIN || c.claimId == claimFilter)
+      claimIds.push_back(c.claimId);
+  }
+  auto arg = [&](size_t i) {
+    return i < args.size() ? std::atoi(args[i].c_str()) : 0;
+  };
+  const std::string &cmd = args[0];
+
+  if (cmd == "info") {
+    const auto frames = store.frames();
+    std::cout << "Records:    " << frames.size();
+    if (!frames.empty())
+      std::cout << " (time " << frames[0].time << " to "
+                << frames[frames.size() - 1].time << ")";
+    std::cout << "\nSnapshots:  "
+              << (store.fullSnapshots() ? "full" : "sparse (no S rows)")
+              << (store.sampled() ? ", sampled agents" : "")
+              << "\nAgents:     " << store.agentCount()
+              << "\nTowns:      " << store.townCount()
+              << "\nLocations:  " << store.locationCount()
+              << "\nChanges:    " << store.changeCount() << "\nClaims:    ";
+    for (const IndexClaim &c : store.claims())
+      std::cout << " " << c.claimId << (c.isMisinfo ? "*" : "");
+    std::cout << "  (* misinformation)" << std::endl;
+    return 0;
+  }
+
+  if ((cmd == "state" && args.size() == 3) ||
+      (cmd == "history" && args.size() == 2)) {
+    int agentId = arg(1);
+    const IndexAgent *a = store.agent(agentId);
+    if (!a) {
+      std::cerr << "Error: no rows for agent " << agentId << std::endl;
+      return 1;
+    }
+    std::cout << "Agent " << agentId << ": town " << a->townId << ", school "
+              << a->schoolId << ", religious " << a->religiousId
+              << ", workplace " << a->workplaceId << ", ethnicity "
+              << a->ethnicity << ", denomination " << a->denomination
+              << std::endl;
+    for (int claimId : claimIds) {
+      if (cmd == "state") {
+        std::cout << "Claim " << claimId << ": "
+                  << stateName(store.stateAt(agentId, claimId, arg(2)))
+                  << std::endl;
+        continue;
+      }
+      std::cout << "Claim " << claimId << ":";
+      for (const IndexChange &c : store.changes(agentId, claimId))
+        std::cout << " " << c.time << ":"
+                  << stateToChar(static_cast<SEDPNRState>(c.state));
+      std::cout << std::endl;
+    }
+    return 0;
+  }
+
+  if ((cmd == "location" || cmd == "town") &&
+      (args.size() == 4 || args.size() == 5)) {
+    int state = parseState(args[2]);
+    if (state < 0) {
+      std::cerr << "Error: unknown state " << args[2] << std::endl;
+      return 1;
+    }
+    int from = arg(3), to = args.size() == 5 ? arg(4) : from;
+    IndexSpan<int32_t> members = cmd == "town" ? store.townMembers(arg(1))
+                                               : store.locationMembers(arg(1));
+    std::cout << members.size() << " members" << std::endl;
+    for (int claimId : claimIds) {
+      std::vector<int> found =
+          cmd == "town"
+              ? store.townInState(arg(1), claimId, state, from, to)
+              : store.inState(members, claimId, state, from, to);
+      std::cout << "Claim " << claimId << ": " << found.size() << " in "
+                << stateName(state);
+      for (int id : found)
+        std::cout << " " << id;
+      std::cout << std::endl;
+    }
+    return 0;
+  }
+
+  if (cmd == "frame" && args.size() == 2) {
+    auto [begin, end] = store.frameText(arg(1));
+    if (!begin) {
+      std::cerr << "Error: no record at time " << arg(1) << std::endl;
+      return 1;
+    }
+    if (claimFilter == INT_MIN) {
+      std::cout.write(begin, end - begin);
+      return 0;
+    }
+    // Rows of one claim, printed as they are in the dump
+    for (const char *p = begin; p < end;) {
+      const char *eol = static_cast<const char *>(
+          std::memchr(p, '\n', static_cast<size_t>(end - p)));
+      const char *next = eol ? eol + 1 : end;
+      int time = 0;
+      Snapshot s;
+      const char *q = p;
+      if (parseSpatialRow(q, next, time, s) && s.claimId == claimFilter)
+        std::cout.write(p, next - p);
+      p = next;
+    }
+    return 0;
+  }
+
+  usage();
+  return 1;
+}
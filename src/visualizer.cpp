@@ -1,13 +1,27 @@
+#include "LiveView.h"
+#include "PngWriter.h"
+#include "SoftRaster.h"
+#include "SpatialLoader.h"
 #include <SFML/Graphics.hpp>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <optional>
 #include <random>
-#include <sstream>
+#include <set>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 struct StateCounts {
@@ -19,20 +33,6 @@ struct StateCounts {
   int recovered = 0;
 };
 
-// Simple struct to hold agent spatial state at a point in time
-struct Snapshot {
-  int agentId;
-  int townId;
-  int schoolId;
-  int religiousId;
-  int workplaceId;
-  int claimId;
-  int state;
-  bool isMisinfo;
-  int ethnicity;
-  int denomination;
-};
-
 // Global config (mirrors dashboard logic)
 struct Config {
   int numTowns = 5;
@@ -108,94 +108,816 @@ sf::Vector2f getSchoolGridCoords(int schoolId, int totalSchools,
   return {c * cellW + cellW * 0.5f, r * cellH + cellH * 0.5f};
 }
 
-enum ViewMode { DISTRICT_VIEW, CHART_VIEW };
+// Screen positions of the agents of one district, indexed by agent ID.
+// Built once per (window size, district) so the render loop does no RNG
+// construction or hub lookups per agent per frame
+struct AgentLayout {
+  int windowSize = -1;
+  int district = -1;
+  std::vector<sf::Vector2f> home;   // Home position in the district
+  std::vector<sf::Vector2f> hub;    // Chosen hub (home if none)
+  std::vector<sf::Vector2f> target; // Drawn position, jitter included
+  std::vector<char> placed;         // Agent belongs to the district
 
-int main() {
-  loadConfig();
+  bool valid(int size, int districtId) const {
+    return windowSize == size && district == districtId;
+  }
 
-  const int WINDOW_SIZE = 800;
-  const int UI_WIDTH = 300;
+  void build(const std::vector<Snapshot> &agents,
+             const std::map<int, std::vector<int>> &townSchools,
+             int districtId, int size, float yOffset, float simHeight) {
+    windowSize = size;
+    district = districtId;
+    home.assign(agents.size(), {0, 0});
+    hub.assign(agents.size(), {0, 0});
+    target.assign(agents.size(), {0, 0});
+    placed.assign(agents.size(), 0);
 
-  sf::VideoMode mode(
-      {(unsigned int)(WINDOW_SIZE + UI_WIDTH), (unsigned int)WINDOW_SIZE});
-  sf::RenderWindow window(mode, "City Simulation Visualizer");
-  window.setFramerateLimit(60);
+    // School grid slot by ID, in the order the loader listed them
+    std::map<int, int> schoolSlot;
+    int numSchools = 0;
+    auto it = townSchools.find(districtId);
+    if (it != townSchools.end()) {
+      numSchools = (int)it->second.size();
+      for (int k = numSchools - 1; k >= 0; --k)
+        schoolSlot[it->second[k]] = k; // First occurrence wins
+    }
+
+    for (const auto &s : agents) {
+      if (s.agentId < 0 || s.townId != districtId)
+        continue;
+      size_t id = (size_t)s.agentId;
+      sf::Vector2f homePos = getAgentHomePos(s.agentId, size);
+      std::vector<sf::Vector2f> hubs;
+      if (s.schoolId != -1) {
+        auto slot = schoolSlot.find(s.schoolId);
+        hubs.push_back(getSchoolGridCoords(
+            slot != schoolSlot.end() ? slot->second : 0, numSchools, size));
+      }
+      if (s.religiousId != -1)
+        hubs.push_back(getLocationCoords(s.religiousId, 34, size));
+      if (s.workplaceId != -1)
+        hubs.push_back(getLocationCoords(s.workplaceId, 56, size));
+
+      // 50% home, 50% one hub chosen deterministically by agent ID
+      sf::Vector2f chosen =
+          hubs.empty() ? homePos : hubs[s.agentId % hubs.size()];
+      float tx = 0.5f * homePos.x + 0.5f * chosen.x;
+      float ty = 0.5f * homePos.y + 0.5f * chosen.y;
+      ty = yOffset + ty * (simHeight / (float)size);
+      sf::Vector2f offset = getAgentOffset(s.agentId);
+
+      home[id] = homePos;
+      hub[id] = chosen;
+      target[id] = {tx + offset.x, ty + offset.y};
+      placed[id] = 1;
+    }
+  }
+};
+
+// Agent dot color for a snapshot's state
+sf::Color stateColor(const Snapshot &s) {
+  if (s.state == 3)
+    return s.isMisinfo ? sf::Color::Red : sf::Color::Blue;
+  if (s.state == 1 || s.state == 2)
+    return sf::Color::Yellow;
+  if (s.state >= 4)
+    return sf::Color::Green;
+  return sf::Color(50, 50, 50, 180);
+}
+
+// Centre and size of a religious or workplace zone in the district view
+struct Zone {
+  sf::Vector2f pos;
+  float radius;
+};
 
-  std::ifstream file("output/spatial_data.csv");
+sf::Vector2f zonePosition(int locationId, int salt, int size, float yOffset,
+                          float simHeight) {
+  sf::Vector2f pos = getLocationCoords(locationId, salt, size);
+  pos.y = yOffset + (pos.y / (float)size) * simHeight;
+  return pos;
+}
+
+// Variable large radius for ~70% total coverage
+Zone religiousZone(int rid, int size, float yOffset, float simHeight) {
+  std::mt19937 rRng(rid * 111 + 555 + g_config.seed);
+  std::uniform_real_distribution<float> rDist(80.0f, 130.0f);
+  return {zonePosition(rid, 34, size, yOffset, simHeight), rDist(rRng)};
+}
+
+Zone workplaceZone(int wid, int size, float yOffset, float simHeight) {
+  std::mt19937 wRng(wid * 222 + 888 + g_config.seed);
+  std::uniform_real_distribution<float> wDist(80.0f, 120.0f);
+  return {zonePosition(wid, 56, size, yOffset, simHeight), wDist(wRng)};
+}
+
+// Fill a triangle list with one 3x3 px square per placed agent of the
+// district, so the whole district draws in a single call
+void fillAgentVertices(sf::VertexArray &verts,
+                       const std::vector<Snapshot> &snapshots,
+                       const AgentLayout &layout, int districtId) {
+  const float size = 3.0f;
+  verts.clear();
+  for (const auto &s : snapshots) {
+    if (s.townId != districtId || s.agentId < 0 ||
+        (size_t)s.agentId >= layout.placed.size() ||
+        !layout.placed[s.agentId])
+      continue;
+    sf::Vector2f p = layout.target[s.agentId];
+    sf::Color color = stateColor(s);
+    sf::Vector2f corners[4] = {
+        p, {p.x + size, p.y}, {p.x + size, p.y + size}, {p.x, p.y + size}};
+    for (int k : {0, 1, 2, 0, 2, 3})
+      verts.append(sf::Vertex{corners[k], color});
+  }
+}
+
+// One town row of output/local_counts.csv
+struct TownCounts {
+  int claimId;
+  int townId;
+  StateCounts counts;
+};
+
+// Per-town counts written by the simulation (rows only where counts
+// changed), keyed by time. Empty if the file is missing
+std::map<int, std::vector<TownCounts>> loadTownSeries() {
+  std::map<int, std::vector<TownCounts>> series;
+  std::ifstream file("output/local_counts.csv");
   std::string line;
-  std::map<int, std::vector<Snapshot>> timeline;
-  std::map<int, std::map<int, std::map<int, StateCounts>>> townTimeline;
-  std::map<int, std::vector<int>> townSchools;
-  std::map<int, std::vector<int>> townReligious;
-  std::map<int, std::vector<int>> townWorkplaces;
-  std::map<int, std::map<int, int>>
-      overallTrends; // [time][claimId] -> Adoption count
-  int maxTime = 0;
-
-  if (file.is_open()) {
-    std::getline(file, line);
-    while (std::getline(file, line)) {
-      std::stringstream ss(line);
-      std::string item;
-      std::vector<int> cols;
-      while (std::getline(ss, item, ',')) {
-        try {
-          cols.push_back(std::stoi(item));
-        } catch (...) {
-          continue;
-        }
+  if (!file.is_open() || !std::getline(file, line))
+    return series;
+  while (std::getline(file, line)) {
+    int time = 0;
+    TownCounts row;
+    char level[16] = "";
+    StateCounts &c = row.counts;
+    if (std::sscanf(line.c_str(), "%d,%d,%15[^,],%d,%d,%d,%d,%d,%d,%d", &time,
+                    &row.claimId, level, &row.townId, &c.susceptible,
+                    &c.exposed, &c.doubtful, &c.propagating, &c.notSpreading,
+                    &c.recovered) == 10 &&
+        std::strcmp(level, "town") == 0)
+      series[time].push_back(row);
+  }
+  return series;
+}
+
+// Last seen row per [claim][agent], and per-town totals per [claim][town]
+using ReplayState = std::map<int, std::map<int, Snapshot>>;
+using TownStats = std::map<int, std::map<int, StateCounts>>;
+
+// Apply one step's rows to replay maps. With town rows from the
+// simulation (replayTownStats false) the totals are taken from them;
+// otherwise they are rebuilt from the snapshot rows
+void applyStep(const std::vector<Snapshot> &rows,
+               const std::vector<TownCounts> *townRows, bool replayTownStats,
+               ReplayState &state, TownStats &townStats) {
+  if (!replayTownStats && townRows) {
+    for (const auto &row : *townRows)
+      townStats[row.claimId][row.townId] = row.counts;
+  }
+  for (auto &s : rows) {
+    if (!replayTownStats) {
+      state[s.claimId][s.agentId] = s;
+      continue;
+    }
+    if (state[s.claimId].count(s.agentId)) {
+      Snapshot old = state[s.claimId][s.agentId];
+      StateCounts &tc = townStats[s.claimId][old.townId];
+      if (old.state == 0)
+        tc.susceptible--;
+      else if (old.state == 1)
+        tc.exposed--;
+      else if (old.state == 2)
+        tc.doubtful--;
+      else if (old.state == 3)
+        tc.propagating--;
+      else if (old.state == 4)
+        tc.notSpreading--;
+      else if (old.state == 5)
+        tc.recovered--;
+    }
+    state[s.claimId][s.agentId] = s;
+    StateCounts &tc = townStats[s.claimId][s.townId];
+    if (s.state == 0)
+      tc.susceptible++;
+    else if (s.state == 1)
+      tc.exposed++;
+    else if (s.state == 2)
+      tc.doubtful++;
+    else if (s.state == 3)
+      tc.propagating++;
+    else if (s.state == 4)
+      tc.notSpreading++;
+    else if (s.state == 5)
+      tc.recovered++;
+  }
+}
+
+// Agents to draw for a claim filter: every agent's most salient claim
+// state in the overview (-1), else the selected claim's states
+void collectDrawn(const ReplayState &state, int selectedClaim,
+                  std::vector<Snapshot> &out) {
+  out.clear();
+  if (selectedClaim == -1) {
+    std::map<int, Snapshot> bestByAgent;
+    for (auto const &entry : state) {
+      for (auto const &entry2 : entry.second) {
+        int aid = entry2.first;
+        const auto &s = entry2.second;
+        if (!bestByAgent.count(aid))
+          bestByAgent[aid] = s;
+        else if (s.state == 3 ||
+                 (s.state != 0 && bestByAgent[aid].state == 0))
+          bestByAgent[aid] = s;
       }
-      if (cols.size() < 8)
+    }
+    for (auto const &entry : bestByAgent)
+      out.push_back(entry.second);
+  } else if (state.count(selectedClaim)) {
+    for (auto const &entry : state.at(selectedClaim))
+      out.push_back(entry.second);
+  }
+}
+
+// Rebuild replay maps from claim-major states [slot * agents + agent],
+// where -1 means the agent has no row for that claim yet. The static
+// fields of each agent come from agentRows
+void restoreStates(const int8_t *states, const std::vector<int> &claimIds,
+                   const std::map<int, bool> &misinfo,
+                   const std::vector<Snapshot> &agentRows,
+                   ReplayState &state) {
+  size_t agents = agentRows.size();
+  state.clear();
+  for (size_t slot = 0; slot < claimIds.size(); ++slot) {
+    int claimId = claimIds[slot];
+    std::map<int, Snapshot> &byAgent = state[claimId];
+    for (size_t a = 0; a < agents; ++a) {
+      int8_t st = states[slot * agents + a];
+      if (st < 0)
         continue;
-      Snapshot s;
-      int time = cols[0];
-      s.agentId = cols[1];
-      if (time > maxTime)
-        maxTime = time;
-      s.townId = cols[2];
-      s.schoolId = cols[3];
-      s.religiousId = cols[4];
-      s.workplaceId = cols[5];
-      s.claimId = cols[6];
-      s.state = cols[7];
-      s.isMisinfo = (cols[8] == 1);
-      if (cols.size() >= 11) {
-        s.ethnicity = cols[9];
-        s.denomination = cols[10];
-      }
-      if (s.schoolId != -1) {
-        bool exists = false;
-        for (int sid : townSchools[s.townId])
-          if (sid == s.schoolId)
-            exists = true;
-        if (!exists)
-          townSchools[s.townId].push_back(s.schoolId);
+      Snapshot s = agentRows[a];
+      s.claimId = claimId;
+      s.state = st;
+      s.isMisinfo = misinfo.at(claimId);
+      byAgent.emplace_hint(byAgent.end(), (int)a, s);
+    }
+  }
+}
+
+// Replay state at one time: each agent's last seen state per claim
+// (-1 if the agent has no row for that claim yet) and the town totals
+struct Keyframe {
+  std::vector<int8_t> states; // [claim slot * agents + agent ID]
+  std::map<int, std::map<int, StateCounts>> townStats;
+};
+
+// Keyframes every `interval` steps, filled in by a background replay of
+// the run. A seek restores the nearest keyframe at or before the target
+// and replays at most interval - 1 steps, whatever the run length or seek
+// direction. Keyframe i may be read once captured() > i
+struct KeyframeIndex {
+  static constexpr size_t BUDGET_BYTES = size_t(256) << 20;
+  static constexpr int MIN_INTERVAL = 16;
+
+  int interval = MIN_INTERVAL;
+  size_t agents = 0;
+  std::vector<int> claims;      // Claim ID per slot
+  std::map<int, bool> misinfo;  // Claim ID -> isMisinfo
+  std::vector<Keyframe> frames; // frames[i] is the state at i * interval
+  std::atomic<size_t> ready{0};
+
+  // Pick the interval so the state arrays stay within the budget
+  void plan(const SpatialIndex &index) {
+    agents = index.agents.size();
+    claims.clear();
+    misinfo = index.claims;
+    for (const auto &entry : misinfo)
+      claims.push_back(entry.first);
+    size_t perFrame = std::max<size_t>(1, claims.size() * agents);
+    size_t maxFrames = std::max<size_t>(1, BUDGET_BYTES / perFrame);
+    interval = std::max(MIN_INTERVAL,
+                        (int)((size_t)(index.maxTime + 1) / maxFrames + 1));
+    frames.assign(index.maxTime / interval + 1, Keyframe());
+    ready = 0;
+  }
+
+  size_t captured() const { return ready.load(std::memory_order_acquire); }
+
+  // Store keyframe i; keyframes are captured in order
+  void capture(size_t i, const ReplayState &state,
+               const TownStats &townStats) {
+    Keyframe &kf = frames[i];
+    kf.states.assign(claims.size() * agents, -1);
+    for (size_t slot = 0; slot < claims.size(); ++slot) {
+      auto it = state.find(claims[slot]);
+      if (it == state.end())
+        continue;
+      for (const auto &entry : it->second)
+        if (entry.first >= 0 && (size_t)entry.first < agents)
+          kf.states[slot * agents + entry.first] = (int8_t)entry.second.state;
+    }
+    kf.townStats = townStats;
+    ready.store(i + 1, std::memory_order_release);
+  }
+
+  // Load keyframe i back into the visualizer's replay maps
+  void restore(size_t i, const std::vector<Snapshot> &agentRows,
+               ReplayState &state, TownStats &townStats) const {
+    const Keyframe &kf = frames[i];
+    restoreStates(kf.states.data(), claims, misinfo, agentRows, state);
+    townStats = kf.townStats;
+  }
+
+  size_t bytes() const { return captured() * claims.size() * agents; }
+};
+
+// A recorded run as the viewer replays it: frames from the timeline, town
+// totals from the simulation's local counts when available (otherwise
+// rebuilt from snapshot rows) and keyframes for seeking. seek() only
+// reads shared data, so threads with their own maps may call it at once
+struct ReplaySource {
+  SpatialTimeline *timeline = nullptr;
+  KeyframeIndex *keyframes = nullptr;
+  const std::vector<Snapshot> *agents = nullptr;
+  const std::map<int, std::vector<TownCounts>> *townSeries = nullptr;
+  bool replayTownStats = true;
+
+  const std::vector<TownCounts> *townRows(int t) const {
+    auto it = townSeries->find(t);
+    return it != townSeries->end() ? &it->second : nullptr;
+  }
+
+  // Replay steps 0..upTo once with private maps, capturing keyframes;
+  // builtTime follows the progress
+  void buildKeyframes(int upTo, std::atomic<int> &builtTime,
+                      const std::atomic<bool> &stop) const {
+    auto start = std::chrono::steady_clock::now();
+    ReplayState state;
+    TownStats townStats;
+    for (int t = 0; t <= upTo && !stop; ++t) {
+      applyStep(timeline->readFrame(t), townRows(t), replayTownStats, state,
+                townStats);
+      if (t % keyframes->interval == 0)
+        keyframes->capture(t / keyframes->interval, state, townStats);
+      builtTime = t;
+    }
+    double secs = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    std::cout << "Built " << keyframes->captured() << " keyframes every "
+              << keyframes->interval << " steps ("
+              << keyframes->bytes() / 1024 << " KB) in " << secs << " s"
+              << std::endl;
+  }
+
+  // Move replay maps from processedTime to targetTime: step forward when
+  // the target is within one interval ahead, otherwise restore the
+  // nearest keyframe. Frames come through the timeline cache
+  void seek(int targetTime, int &processedTime, ReplayState &state,
+            TownStats &townStats) const {
+    int kfTime = (targetTime / keyframes->interval) * keyframes->interval;
+    if (targetTime < processedTime || processedTime < kfTime) {
+      keyframes->restore(kfTime / keyframes->interval, *agents, state,
+                         townStats);
+      processedTime = kfTime;
+    }
+    for (int t = processedTime + 1; t <= targetTime; ++t)
+      applyStep(*timeline->frame(t), townRows(t), replayTownStats, state,
+                townStats);
+    processedTime = targetTime;
+  }
+};
+
+// Index of a live-view region: the static agent rows, claims and the
+// locations of each town in agent order. Trends grow as steps arrive
+SpatialIndex indexFromLive(const LiveSubscriber &live,
+                           std::vector<int> &claimIds) {
+  SpatialIndex index;
+  claimIds.clear();
+  for (size_t c = 0; c < live.claims(); ++c) {
+    const LiveClaim &claim = live.claimRows()[c];
+    index.claims[claim.claimId] = claim.isMisinfo != 0;
+    claimIds.push_back(claim.claimId);
+  }
+  std::set<std::pair<int, int>> seen[3];
+  std::map<int, std::vector<int>> *lists[3] = {
+      &index.townSchools, &index.townReligious, &index.townWorkplaces};
+  index.agents.resize(live.agents());
+  for (size_t a = 0; a < live.agents(); ++a) {
+    const LiveAgent &row = live.agentRows()[a];
+    Snapshot &s = index.agents[a];
+    s = Snapshot{};
+    s.agentId = (int)a;
+    s.townId = row.townId;
+    s.schoolId = row.schoolId;
+    s.religiousId = row.religiousId;
+    s.workplaceId = row.workplaceId;
+    s.ethnicity = row.ethnicity;
+    s.denomination = row.denomination;
+    const int locs[3] = {row.schoolId, row.religiousId, row.workplaceId};
+    for (int k = 0; k < 3; ++k)
+      if (locs[k] != -1 && seen[k].insert({row.townId, locs[k]}).second)
+        (*lists[k])[row.townId].push_back(locs[k]);
+  }
+  return index;
+}
+
+// Per-town totals of claim-major states
+TownStats townStatsFromStates(const int8_t *states,
+                              const std::vector<int> &claimIds,
+                              const std::vector<Snapshot> &agentRows) {
+  TownStats stats;
+  size_t agents = agentRows.size();
+  for (size_t slot = 0; slot < claimIds.size(); ++slot) {
+    std::map<int, StateCounts> &towns = stats[claimIds[slot]];
+    for (size_t a = 0; a < agents; ++a) {
+      StateCounts &tc = towns[agentRows[a].townId];
+      switch (states[slot * agents + a]) {
+      case 0:
+        tc.susceptible++;
+        break;
+      case 1:
+        tc.exposed++;
+        break;
+      case 2:
+        tc.doubtful++;
+        break;
+      case 3:
+        tc.propagating++;
+        break;
+      case 4:
+        tc.notSpreading++;
+        break;
+      case 5:
+        tc.recovered++;
+        break;
+      default:
+        break;
       }
-      if (s.religiousId != -1) {
-        bool exists = false;
-        for (int rid : townReligious[s.townId])
-          if (rid == s.religiousId)
-            exists = true;
-        if (!exists)
-          townReligious[s.townId].push_back(s.religiousId);
+    }
+  }
+  return stats;
+}
+
+// Chart color of a claim: blues for truth and reds for misinformation,
+// varied by how many claims of the same stance come before it
+sf::Color claimColor(bool misinfo, int rank) {
+  static const sf::Color truth[] = {sf::Color::Blue, sf::Color(56, 189, 248),
+                                    sf::Color(45, 212, 191),
+                                    sf::Color(129, 140, 248),
+                                    sf::Color(34, 197, 94)};
+  static const sf::Color lies[] = {sf::Color::Red, sf::Color(249, 115, 22),
+                                   sf::Color(236, 72, 153),
+                                   sf::Color(234, 179, 8),
+                                   sf::Color(168, 85, 247)};
+  return misinfo ? lies[rank % 5] : truth[rank % 5];
+}
+
+// Adopters (P + N + R) per claim as dense arrays over time. For runs
+// longer than the chart is wide, the min and max of every pixel column
+// are precomputed, so a frame draws at most two vertices per column and
+// claim whatever the run length
+class AdoptionChart {
+public:
+  struct Series {
+    int claimId;
+    bool misinfo;
+    sf::Color color;
+    std::vector<int> adopted;              // [t]
+    std::vector<std::pair<int, int>> cols; // (min, max) per column
+  };
+
+  // Steps without rows keep the previous total: adoption never decreases
+  void build(const std::map<int, std::map<int, int>> &trends,
+             const std::map<int, bool> &claims, int maxTime) {
+    series.clear();
+    int ranks[2] = {0, 0};
+    for (const auto &[claimId, misinfo] : claims) {
+      Series s{claimId, misinfo, claimColor(misinfo, ranks[misinfo]++), {},
+               {}};
+      s.adopted.assign(maxTime + 1, 0);
+      series.push_back(std::move(s));
+    }
+    for (auto &s : series) {
+      int last = 0;
+      auto row = trends.begin();
+      for (int t = 0; t <= maxTime; ++t) {
+        while (row != trends.end() && row->first < t)
+          ++row;
+        if (row != trends.end() && row->first == t) {
+          auto it = row->second.find(s.claimId);
+          last = it != row->second.end() ? it->second : 0;
+        }
+        s.adopted[t] = last;
       }
-      if (s.workplaceId != -1) {
-        bool exists = false;
-        for (int wid : townWorkplaces[s.townId])
-          if (wid == s.workplaceId)
-            exists = true;
-        if (!exists)
-          townWorkplaces[s.townId].push_back(s.workplaceId);
+    }
+    steps = maxTime + 1;
+    columns = 0;
+  }
+
+  const std::vector<Series> &all() const { return series; }
+
+  // Precompute per-column min/max for a chart `width` pixels wide
+  void decimate(int width) {
+    columns = std::max(1, width);
+    for (auto &s : series) {
+      s.cols.assign(columns, {0, 0});
+      for (int c = 0; c < columns; ++c) {
+        int lo = columnStart(c), hi = columnStart(c + 1);
+        if (lo >= hi)
+          continue;
+        auto [mn, mx] = std::minmax_element(s.adopted.begin() + lo,
+                                            s.adopted.begin() + hi);
+        s.cols[c] = {*mn, *mx};
       }
-      timeline[time].push_back(s);
+    }
+  }
+
+  int width() const { return columns; }
 
-      // Track trends (Adoption = P, N, or R)
-      if (s.state >= 3) {
-        overallTrends[time][s.claimId]++;
+  // Line strip for one series up to step upTo inside a w x h box at
+  // (x, y), scaled so that `total` adopters reach the top
+  void line(const Series &s, int upTo, float x, float y, float w, float h,
+            float total, std::vector<sf::Vertex> &out) const {
+    out.clear();
+    upTo = std::min(upTo, steps - 1);
+    auto point = [&](float px, int adopted) {
+      out.push_back(sf::Vertex{
+          sf::Vector2f(px, y + h - ((float)adopted / total) * h), s.color});
+    };
+    float span = (float)std::max(1, steps - 1);
+    if (steps <= columns) {
+      for (int t = 0; t <= upTo; ++t)
+        point(x + (t / span) * w, s.adopted[t]);
+      return;
+    }
+    for (int c = 0; c < columns && columnStart(c) <= upTo; ++c) {
+      int lo = columnStart(c), hi = columnStart(c + 1);
+      float px = x + (lo / span) * w;
+      if (hi - 1 <= upTo) {
+        point(px, s.cols[c].first);
+        point(px, s.cols[c].second);
+      } else {
+        auto [mn, mx] = std::minmax_element(s.adopted.begin() + lo,
+                                            s.adopted.begin() + upTo + 1);
+        point(px, *mn);
+        point(px, *mx);
       }
     }
   }
 
+private:
+  int columnStart(int c) const {
+    return (int)((long long)c * steps / columns);
+  }
+
+  std::vector<Series> series;
+  int steps = 0;
+  int columns = 0;
+};
+
+// ============================================================================
+// HEADLESS EXPORT
+// `--export DIR` renders steps into numbered PNGs with the software
+// rasterizer instead of opening a window, so batch nodes without a display
+// or GPU can produce videos. Each frame is 1600 x 800: the district view on
+// the left and the adoption chart up to that step on the right. Frames are
+// split into contiguous runs, one per thread; each thread seeks once from
+// the nearest keyframe and then steps forward with its own replay maps.
+// ============================================================================
+
+struct ExportOptions {
+  std::string dir;
+  int from = 0;
+  int to = -1; // Last step of the run
+  int step = 1;
+  int claim = -1; // Claim filter, -1 for the overview
+  int district = 0;
+  int threads = 0; // 0: one per hardware thread
+};
+
+Rgba toRgba(sf::Color c) { return {c.r, c.g, c.b, c.a}; }
+
+const int EXPORT_VIEW_SIZE = 800;
+const float EXPORT_Y_OFFSET = 40.0f;
+
+// Background and location zones of a district, the same in every frame
+void renderExportBackground(Canvas &canvas, const SpatialIndex &index,
+                            int district) {
+  const int VIEW_SIZE = EXPORT_VIEW_SIZE;
+  const float yOffset = EXPORT_Y_OFFSET;
+  const float simHeight = VIEW_SIZE - yOffset;
+  canvas.clear({15, 15, 15, 255});
+
+  auto zones = index.townReligious.find(district);
+  if (zones != index.townReligious.end()) {
+    for (int rid : zones->second) {
+      Zone z = religiousZone(rid, VIEW_SIZE, yOffset, simHeight);
+      Point2 c{z.pos.x, z.pos.y};
+      std::vector<Point2> inner = regularPolygon(c, z.radius, 48);
+      canvas.fillConvex(inner, {168, 85, 247, 40});
+      canvas.fillConvex(regularPolygon(c, z.radius + 2.0f, 48),
+                        {168, 85, 247, 180}, &inner);
+    }
+  }
+  zones = index.townWorkplaces.find(district);
+  if (zones != index.townWorkplaces.end()) {
+    for (int wid : zones->second) {
+      Zone z = workplaceZone(wid, VIEW_SIZE, yOffset, simHeight);
+      Point2 c{z.pos.x, z.pos.y};
+      std::vector<Point2> inner = regularPolygon(c, z.radius, 6);
+      canvas.fillConvex(inner, {245, 158, 11, 30});
+      // The outline sits outside the edges, 2 px from each side
+      canvas.fillConvex(regularPolygon(c, z.radius + 2.0f / 0.866f, 6),
+                        {245, 158, 11, 150}, &inner);
+    }
+  }
+
+}
+
+// Draw one export frame for the replay state at `time` over a copy of the
+// district background
+void renderExportFrame(Canvas &canvas, const Canvas &background,
+                       const SpatialIndex &index, const AgentLayout &layout,
+                       const AdoptionChart &chart,
+                       const std::vector<Snapshot> &drawn, int district,
+                       int time, std::vector<sf::Vertex> &line) {
+  const int VIEW_SIZE = EXPORT_VIEW_SIZE;
+  const float yOffset = EXPORT_Y_OFFSET;
+  const float simHeight = VIEW_SIZE - yOffset;
+  canvas.copyFrom(background);
+
+  for (const auto &s : drawn) {
+    if (s.townId != district || s.agentId < 0 ||
+        (size_t)s.agentId >= layout.placed.size() || !layout.placed[s.agentId])
+      continue;
+    sf::Vector2f p = layout.target[s.agentId];
+    canvas.fillRect(p.x, p.y, 3.0f, 3.0f, toRgba(stateColor(s)));
+  }
+
+  // Chart panel, laid out as the window's TRENDS tab
+  float graphX = VIEW_SIZE + 50.0f;
+  float graphY = yOffset + 50.0f;
+  float graphW = VIEW_SIZE - 100.0f;
+  float graphH = simHeight - 120.0f;
+  Rgba axis{100, 100, 100, 255};
+  canvas.line({graphX, graphY}, {graphX, graphY + graphH}, axis);
+  canvas.line({graphX, graphY + graphH}, {graphX + graphW, graphY + graphH},
+              axis);
+  float totalPop = (float)std::max(1, g_config.population);
+  for (const auto &series : chart.all()) {
+    chart.line(series, time, graphX, graphY, graphW, graphH, totalPop, line);
+    for (size_t k = 1; k < line.size(); ++k)
+      canvas.line({line[k - 1].position.x, line[k - 1].position.y},
+                  {line[k].position.x, line[k].position.y},
+                  toRgba(series.color));
+  }
+
+  canvas.text(12, 12,
+              std::to_string(time) + "/" + std::to_string(index.maxTime), 3,
+              {255, 255, 255, 255});
+}
+
+int runExport(const ExportOptions &opt, size_t cacheBytes) {
+  auto start = std::chrono::steady_clock::now();
+  SpatialTimeline timeline("output/spatial_data.csv", cacheBytes);
+  while (!timeline.indexed())
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const SpatialIndex &index = timeline.index();
+  if (index.agents.empty()) {
+    std::cerr << "No spatial data in output/spatial_data.csv" << std::endl;
+    return 1;
+  }
+
+  std::vector<int> times;
+  int last = opt.to < 0 ? index.maxTime : std::min(opt.to, index.maxTime);
+  for (int t = std::max(0, opt.from); t <= last; t += std::max(1, opt.step))
+    times.push_back(t);
+  if (times.empty()) {
+    std::cerr << "No steps to export" << std::endl;
+    return 1;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(opt.dir, ec);
+  if (ec) {
+    std::cerr << "Cannot create " << opt.dir << ": " << ec.message()
+              << std::endl;
+    return 1;
+  }
+
+  // Keyframes are only needed up to the last exported step
+  std::map<int, std::vector<TownCounts>> townSeries = loadTownSeries();
+  KeyframeIndex keyframes;
+  keyframes.plan(index);
+  ReplaySource replay{&timeline, &keyframes, &index.agents, &townSeries,
+                      townSeries.empty()};
+  std::atomic<int> builtTime{-1};
+  std::atomic<bool> stop{false};
+  replay.buildKeyframes(last, builtTime, stop);
+
+  AgentLayout layout;
+  layout.build(index.agents, index.townSchools, opt.district,
+               EXPORT_VIEW_SIZE, EXPORT_Y_OFFSET,
+               EXPORT_VIEW_SIZE - EXPORT_Y_OFFSET);
+  Canvas background(2 * EXPORT_VIEW_SIZE, EXPORT_VIEW_SIZE);
+  renderExportBackground(background, index, opt.district);
+  AdoptionChart chart;
+  chart.build(index.overallTrends, index.claims, index.maxTime);
+  chart.decimate(700);
+
+  size_t threads = opt.threads > 0
+                       ? (size_t)opt.threads
+                       : std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, times.size());
+  std::atomic<size_t> failed{0};
+  auto worker = [&](size_t begin, size_t end) {
+    ReplayState state;
+    TownStats townStats;
+    int processed = -1;
+    Canvas canvas(background.width(), background.height());
+    std::vector<Snapshot> drawn;
+    std::vector<sf::Vertex> line;
+    char name[32];
+    for (size_t i = begin; i < end; ++i) {
+      replay.seek(times[i], processed, state, townStats);
+      collectDrawn(state, opt.claim, drawn);
+      renderExportFrame(canvas, background, index, layout, chart, drawn,
+                        opt.district, times[i], line);
+      std::snprintf(name, sizeof(name), "frame_%06zu.png", i);
+      std::string path = (std::filesystem::path(opt.dir) / name).string();
+      if (!writePng(path, canvas.data(), canvas.width(), canvas.height()))
+        failed++;
+    }
+  };
+  std::vector<std::thread> pool;
+  for (size_t k = 0; k < threads; ++k)
+    pool.emplace_back(worker, times.size() * k / threads,
+                      times.size() * (k + 1) / threads);
+  for (auto &t : pool)
+    t.join();
+
+  double secs =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << "Exported " << times.size() - failed << " frames to "
+            << opt.dir << " in " << secs << " s (" << threads << " threads)"
+            << std::endl;
+  if (failed > 0) {
+    std::cerr << failed << " frames could not be written" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+enum ViewMode { DISTRICT_VIEW, CHART_VIEW };
+
+int main(int argc, char **argv) {
+  loadConfig();
+
+  // --cache-mb N: frame cache cap (the dump is never fully loaded)
+  // --live: follow a running simulation with live_view=true
+  // --export DIR [--from A] [--to B] [--step S] [--claim C] [--district D]
+  //   [--threads N]: write PNG frames without opening a window
+  size_t cacheMb = 1024;
+  bool liveMode = false;
+  ExportOptions exportOpts;
+  for (int i = 1; i < argc; ++i) {
+    auto intArg = [&](int &out) {
+      if (i + 1 < argc)
+        out = std::atoi(argv[++i]);
+    };
+    if (std::strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc)
+      cacheMb = std::max(1, std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "--live") == 0)
+      liveMode = true;
+    else if (std::strcmp(argv[i], "--export") == 0 && i + 1 < argc)
+      exportOpts.dir = argv[++i];
+    else if (std::strcmp(argv[i], "--from") == 0)
+      intArg(exportOpts.from);
+    else if (std::strcmp(argv[i], "--to") == 0)
+      intArg(exportOpts.to);
+    else if (std::strcmp(argv[i], "--step") == 0)
+      intArg(exportOpts.step);
+    else if (std::strcmp(argv[i], "--claim") == 0)
+      intArg(exportOpts.claim);
+    else if (std::strcmp(argv[i], "--district") == 0)
+      intArg(exportOpts.district);
+    else if (std::strcmp(argv[i], "--threads") == 0)
+      intArg(exportOpts.threads);
+  }
+  if (!exportOpts.dir.empty())
+    return runExport(exportOpts, cacheMb << 20);
+
+  const int WINDOW_SIZE = 800;
+  const int UI_WIDTH = 300;
+
+  sf::VideoMode mode(
+      {(unsigned int)(WINDOW_SIZE + UI_WIDTH), (unsigned int)WINDOW_SIZE});
+  sf::RenderWindow window(mode, "City Simulation Visualizer");
+  window.setFramerateLimit(60);
+
   sf::Font font;
   bool fontLoaded = false;
   std::vector<std::string> fontPaths = {"/System/Library/Fonts/Helvetica.ttc",
@@ -207,6 +929,53 @@ int main() {
     }
   }
 
+
+  // The window opens at once. A replay indexes the dump in the
+  // background; a live view waits for the simulation's shared memory
+  std::unique_ptr<SpatialTimeline> timeline;
+  LiveSubscriber live;
+  if (!liveMode)
+    timeline = std::make_unique<SpatialTimeline>("output/spatial_data.csv",
+                                                 cacheMb << 20);
+  auto loaded = [&] { return liveMode ? live.attach() : timeline->indexed(); };
+  while (window.isOpen() && !loaded()) {
+    while (const std::optional event = window.pollEvent())
+      if (event->is<sf::Event::Closed>())
+        window.close();
+    window.clear(sf::Color(15, 15, 15));
+    if (fontLoaded) {
+      char buf[64];
+      if (liveMode)
+        std::snprintf(buf, sizeof(buf), "Waiting for a live_view simulation");
+      else
+        std::snprintf(buf, sizeof(buf), "Indexing spatial data: %d%%",
+                      (int)(timeline->progress() * 100));
+      sf::Text txt(font, buf, 16);
+      txt.setPosition({20, 20});
+      txt.setFillColor(sf::Color(150, 150, 150));
+      window.draw(txt);
+    }
+    window.display();
+  }
+  if (!window.isOpen())
+    return 0;
+
+  std::vector<int> liveClaims;
+  std::vector<int8_t> liveStates;
+  SpatialIndex liveIndex;
+  if (liveMode)
+    liveIndex = indexFromLive(live, liveClaims);
+  const SpatialIndex &index = liveMode ? liveIndex : timeline->index();
+  const auto &townSchools = index.townSchools;
+  const auto &townReligious = index.townReligious;
+  const auto &townWorkplaces = index.townWorkplaces;
+  const auto &overallTrends = index.overallTrends;
+  int maxTime = index.maxTime;
+  AgentLayout layout;
+  AdoptionChart chart;
+  chart.build(overallTrends, index.claims, maxTime);
+  std::vector<sf::Vertex> chartLine;
+
   int currentTime = 0;
   int selectedClaim = -1;
   bool isPlaying = true;
@@ -215,58 +984,42 @@ int main() {
   ViewMode currentView = DISTRICT_VIEW;
   int currentDistrictId = 0;
 
-  std::map<int, std::map<int, Snapshot>> persistentState;
-  std::map<int, std::map<int, StateCounts>> persistentTownStats;
+  ReplayState persistentState;
+  TownStats persistentTownStats;
   int lastProcessedTime = -1;
 
-  auto updatePersistentState = [&](int targetTime) {
-    if (targetTime < lastProcessedTime) {
-      persistentState.clear();
-      persistentTownStats.clear();
-      lastProcessedTime = -1;
-    }
-    for (int t = lastProcessedTime + 1; t <= targetTime; ++t) {
-      if (timeline.count(t)) {
-        for (auto &s : timeline[t]) {
-          if (persistentState[s.claimId].count(s.agentId)) {
-            Snapshot old = persistentState[s.claimId][s.agentId];
-            StateCounts &tc = persistentTownStats[s.claimId][old.townId];
-            if (old.state == 0)
-              tc.susceptible--;
-            else if (old.state == 1)
-              tc.exposed--;
-            else if (old.state == 2)
-              tc.doubtful--;
-            else if (old.state == 3)
-              tc.propagating--;
-            else if (old.state == 4)
-              tc.notSpreading--;
-            else if (old.state == 5)
-              tc.recovered--;
-          }
-          persistentState[s.claimId][s.agentId] = s;
-          StateCounts &tc = persistentTownStats[s.claimId][s.townId];
-          if (s.state == 0)
-            tc.susceptible++;
-          else if (s.state == 1)
-            tc.exposed++;
-          else if (s.state == 2)
-            tc.doubtful++;
-          else if (s.state == 3)
-            tc.propagating++;
-          else if (s.state == 4)
-            tc.notSpreading++;
-          else if (s.state == 5)
-            tc.recovered++;
-        }
-      }
-    }
-    lastProcessedTime = targetTime;
-  };
+  // Town totals come straight from the simulation's local counts when
+  // available; otherwise they are rebuilt by replaying snapshot rows
+  std::map<int, std::vector<TownCounts>> townSeries;
+  if (!liveMode)
+    townSeries = loadTownSeries();
+  bool replayTownStats = townSeries.empty();
+
+  // Keyframes are built by replaying the run on a background thread with
+  // its own maps; steps up to builtTime can be shown
+  KeyframeIndex keyframes;
+  ReplaySource replay{timeline.get(), &keyframes, &index.agents, &townSeries,
+                      replayTownStats};
+  std::atomic<int> builtTime{-1};
+  std::atomic<bool> stopBuild{false};
+  std::thread builder;
+  if (!liveMode) {
+    keyframes.plan(index);
+    builder = std::thread(
+        [&] { replay.buildKeyframes(maxTime, builtTime, stopBuild); });
+  }
 
-  updatePersistentState(0);
+  std::vector<Snapshot> toDraw;
+
+  sf::VertexArray agentVerts(sf::PrimitiveType::Triangles);
+  // (time, claim filter, district) the vertex array was filled for
+  std::tuple<int, int, int> agentVertsKey{-1, -1, -1};
+
+  const int PREFETCH_FRAMES = 8;
 
   while (window.isOpen()) {
+    // Steps past the background replay cannot be shown yet
+    int availableTime = liveMode ? maxTime : builtTime.load();
     while (const std::optional event = window.pollEvent()) {
       if (event->is<sf::Event::Closed>())
         window.close();
@@ -280,7 +1033,7 @@ int main() {
         if (keyPressed->code == sf::Keyboard::Key::Left)
           currentTime = std::max(0, currentTime - 1);
         if (keyPressed->code == sf::Keyboard::Key::Right)
-          currentTime = std::min(maxTime, currentTime + 1);
+          currentTime = std::min(availableTime, currentTime + 1);
       } else if (const auto *mouseButtonPressed =
                      event->getIf<sf::Event::MouseButtonPressed>()) {
         if (mouseButtonPressed->button == sf::Mouse::Button::Left) {
@@ -306,17 +1059,43 @@ int main() {
       }
     }
 
-    if (isPlaying &&
-        playbackClock.getElapsedTime().asSeconds() > (0.1f / playbackSpeed)) {
-      currentTime++;
-      playbackClock.restart();
-      if (currentTime > maxTime) {
-        currentTime = 0;
-        isPlaying = false;
+    if (liveMode) {
+      // Follow the newest published step; a slow viewer skips steps
+      int time = 0;
+      if (live.latest(liveStates, time)) {
+        restoreStates(liveStates.data(), liveClaims, index.claims,
+                      index.agents, persistentState);
+        persistentTownStats =
+            townStatsFromStates(liveStates.data(), liveClaims, index.agents);
+        std::map<int, int> &adopted = liveIndex.overallTrends[time];
+        adopted.clear();
+        for (const auto &[claimId, byAgent] : persistentState)
+          for (const auto &entry : byAgent)
+            if (entry.second.state >= 3)
+              adopted[claimId]++;
+        maxTime = std::max(maxTime, time);
+        lastProcessedTime = time;
+        chart.build(overallTrends, index.claims, maxTime);
+      }
+      currentTime = std::max(0, lastProcessedTime);
+    } else {
+      if (isPlaying &&
+          playbackClock.getElapsedTime().asSeconds() >
+              (0.1f / playbackSpeed) &&
+          (currentTime < availableTime || availableTime == maxTime)) {
+        currentTime++;
+        playbackClock.restart();
+        if (currentTime > maxTime) {
+          currentTime = 0;
+          isPlaying = false;
+        }
       }
+      if (currentTime != lastProcessedTime && currentTime <= availableTime)
+        replay.seek(currentTime, lastProcessedTime, persistentState,
+                    persistentTownStats);
+      if (isPlaying)
+        timeline->prefetch(currentTime + 1, PREFETCH_FRAMES);
     }
-    if (currentTime != lastProcessedTime)
-      updatePersistentState(currentTime);
 
     window.clear(sf::Color(15, 15, 15));
 
@@ -357,19 +1136,12 @@ int main() {
     // Background Zones
     if (currentView != CHART_VIEW) {
       if (townReligious.count(currentDistrictId)) {
-        for (int rid : townReligious[currentDistrictId]) {
-          sf::Vector2f pos = getLocationCoords(rid, 34, WINDOW_SIZE);
-          pos.y = simAreaYOffset +
-                  (pos.y / (float)WINDOW_SIZE) * availableSimHeight;
-
-          // Variable large radius for ~70% total coverage
-          std::mt19937 rRng(rid * 111 + 555 + g_config.seed);
-          std::uniform_real_distribution<float> rDist(80.0f, 130.0f);
-          float radius = rDist(rRng);
-
-          sf::CircleShape zone(radius);
-          zone.setOrigin({radius, radius});
-          zone.setPosition(pos);
+        for (int rid : townReligious.at(currentDistrictId)) {
+          Zone z = religiousZone(rid, WINDOW_SIZE, simAreaYOffset,
+                                 availableSimHeight);
+          sf::CircleShape zone(z.radius);
+          zone.setOrigin({z.radius, z.radius});
+          zone.setPosition(z.pos);
           zone.setFillColor(sf::Color(
               168, 85, 247, 40)); // slightly more transparent for overlap
           zone.setOutlineThickness(2.0f);
@@ -378,23 +1150,15 @@ int main() {
         }
       }
       if (townWorkplaces.count(currentDistrictId)) {
-        for (int wid : townWorkplaces[currentDistrictId]) {
-          sf::Vector2f pos = getLocationCoords(wid, 56, WINDOW_SIZE);
-          pos.y = simAreaYOffset +
-                  (pos.y / (float)WINDOW_SIZE) * availableSimHeight;
-
+        for (int wid : townWorkplaces.at(currentDistrictId)) {
+          Zone z = workplaceZone(wid, WINDOW_SIZE, simAreaYOffset,
+                                 availableSimHeight);
           sf::ConvexShape zone;
           zone.setPointCount(6);
-
-          // Variable large size
-          std::mt19937 wRng(wid * 222 + 888 + g_config.seed);
-          std::uniform_real_distribution<float> wDist(80.0f, 120.0f);
-          float r = wDist(wRng);
-
           for (int i = 0; i < 6; ++i)
-            zone.setPoint(
-                i, {r * (float)cos(i * 1.047f), r * (float)sin(i * 1.047f)});
-          zone.setPosition(pos);
+            zone.setPoint(i, {z.radius * (float)cos(i * 1.047f),
+                              z.radius * (float)sin(i * 1.047f)});
+          zone.setPosition(z.pos);
           zone.setFillColor(sf::Color(245, 158, 11, 30)); // overlapping amber
           zone.setOutlineThickness(2.0f);
           zone.setOutlineColor(sf::Color(245, 158, 11, 150));
@@ -403,32 +1167,6 @@ int main() {
       }
     }
 
-    std::vector<Snapshot> toDraw;
-    if (selectedClaim == -1) {
-      std::map<int, Snapshot> bestByAgent;
-      for (auto const &entry : persistentState) {
-        const auto &agents = entry.second;
-        for (auto const &entry2 : agents) {
-          int aid = entry2.first;
-          const auto &s = entry2.second;
-          if (!bestByAgent.count(aid))
-            bestByAgent[aid] = s;
-          else if (s.state == 3 ||
-                   (s.state != 0 && bestByAgent[aid].state == 0))
-            bestByAgent[aid] = s;
-        }
-      }
-      for (auto const &entry : bestByAgent) {
-        const auto &s = entry.second;
-        toDraw.push_back(s);
-      }
-    } else if (persistentState.count(selectedClaim)) {
-      for (auto const &entry : persistentState.at(selectedClaim)) {
-        const auto &s = entry.second;
-        toDraw.push_back(s);
-      }
-    }
-
     if (currentView == CHART_VIEW) {
       // Draw Adoption Trends Graph
       float graphX = 50.0f;
@@ -453,26 +1191,15 @@ int main() {
         if (totalPop <= 0)
           totalPop = 1.0f;
 
-        // Draw Lines for each claim
-        // Factual = Blue (0), Misinfo = Red (1)
-        std::map<int, sf::Color> claimColors = {{0, sf::Color::Blue},
-                                                {1, sf::Color::Red}};
-
-        for (int cid = 0; cid < 2; ++cid) {
-          sf::Color col =
-              claimColors.count(cid) ? claimColors[cid] : sf::Color::White;
-          std::vector<sf::Vertex> line;
-          for (int t = 0; t <= currentTime; ++t) {
-            int adopted = overallTrends.count(t) && overallTrends[t].count(cid)
-                              ? overallTrends[t][cid]
-                              : 0;
-            float px = graphX + ((float)t / maxTime) * graphW;
-            float py = graphY + graphH - ((float)adopted / totalPop) * graphH;
-            line.push_back(sf::Vertex{sf::Vector2f(px, py), col});
-          }
-          if (line.size() > 1) {
-            window.draw(line.data(), line.size(), sf::PrimitiveType::LineStrip);
-          }
+        // One line per claim, decimated to the chart width
+        if (chart.width() != (int)graphW)
+          chart.decimate((int)graphW);
+        for (const auto &series : chart.all()) {
+          chart.line(series, currentTime, graphX, graphY, graphW, graphH,
+                     totalPop, chartLine);
+          if (chartLine.size() > 1)
+            window.draw(chartLine.data(), chartLine.size(),
+                        sf::PrimitiveType::LineStrip);
         }
       }
 
@@ -489,66 +1216,21 @@ int main() {
         window.draw(yLabel);
       }
     } else {
-      // Draw Agents
-      for (auto &s : toDraw) {
-        if (s.townId != currentDistrictId)
-          continue;
-        sf::Vector2f homePos = getAgentHomePos(s.agentId, WINDOW_SIZE);
-        sf::Vector2f sPos = {0, 0}, rPos = {0, 0}, wPos = {0, 0};
-        bool hasS = (s.schoolId != -1), hasR = (s.religiousId != -1),
-             hasW = (s.workplaceId != -1);
-        if (hasS) {
-          auto &v = townSchools[s.townId];
-          int sIdx = 0;
-          for (size_t k = 0; k < v.size(); ++k)
-            if (v[k] == s.schoolId) {
-              sIdx = k;
-              break;
-            }
-          sPos = getSchoolGridCoords(sIdx, v.size(), WINDOW_SIZE);
-        }
-        if (hasR)
-          rPos = getLocationCoords(s.religiousId, 34, WINDOW_SIZE);
-        if (hasW)
-          wPos = getLocationCoords(s.workplaceId, 56, WINDOW_SIZE);
-
-        float tx = 0.5f * homePos.x, ty = 0.5f * homePos.y;
-        int hubs = (hasS ? 1 : 0) + (hasR ? 1 : 0) + (hasW ? 1 : 0);
-        if (hubs > 0) {
-          // Choose ONE hub deterministically based on agent ID
-          std::vector<sf::Vector2f> availableHubs;
-          if (hasS)
-            availableHubs.push_back(sPos);
-          if (hasR)
-            availableHubs.push_back(rPos);
-          if (hasW)
-            availableHubs.push_back(wPos);
-
-          int chosenIndex = s.agentId % availableHubs.size();
-          sf::Vector2f chosenHub = availableHubs[chosenIndex];
-
-          // 50% Home, 50% Selected Hub
-          tx += 0.5f * chosenHub.x;
-          ty += 0.5f * chosenHub.y;
-        } else {
-          tx = homePos.x;
-          ty = homePos.y;
-        }
-
-        ty = simAreaYOffset + ty * (availableSimHeight / (float)WINDOW_SIZE);
-        auto offset = getAgentOffset(s.agentId);
-        sf::CircleShape agent(1.5f);
-        agent.setPosition({tx + offset.x, ty + offset.y});
-        sf::Color color(50, 50, 50, 180);
-        if (s.state == 3)
-          color = s.isMisinfo ? sf::Color::Red : sf::Color::Blue;
-        else if (s.state == 1 || s.state == 2)
-          color = sf::Color::Yellow;
-        else if (s.state >= 4)
-          color = sf::Color::Green;
-        agent.setFillColor(color);
-        window.draw(agent);
+      // Draw Agents: one vertex array, refilled only when the drawn
+      // states, the claim filter or the layout change
+      if (!layout.valid(WINDOW_SIZE, currentDistrictId)) {
+        layout.build(index.agents, townSchools, currentDistrictId, WINDOW_SIZE,
+                     simAreaYOffset, availableSimHeight);
+        agentVertsKey = {-1, -1, -1};
+      }
+      auto key =
+          std::make_tuple(lastProcessedTime, selectedClaim, currentDistrictId);
+      if (key != agentVertsKey) {
+        collectDrawn(persistentState, selectedClaim, toDraw);
+        fillAgentVertices(agentVerts, toDraw, layout, currentDistrictId);
+        agentVertsKey = key;
       }
+      window.draw(agentVerts);
     }
 
     // UI Panel (Side Analytics & Legend)
@@ -622,10 +1304,13 @@ int main() {
       std::snprintf(reachBuf, sizeof(reachBuf), "%.1f%%", reachP);
       drawStat("TOTAL REACH", reachBuf, 240, sf::Color(79, 70, 229));
 
-      sf::Text timeLabel(font,
-                         "Time: " + std::to_string(currentTime) + " / " +
-                             std::to_string(maxTime),
-                         16);
+      std::string timeStr = "Time: " + std::to_string(currentTime) + " / " +
+                            std::to_string(maxTime);
+      if (liveMode)
+        timeStr += " (live)";
+      else if (availableTime < maxTime)
+        timeStr += " (loaded " + std::to_string(availableTime) + ")";
+      sf::Text timeLabel(font, timeStr, 16);
       timeLabel.setPosition({(float)WINDOW_SIZE + 20, 330});
       timeLabel.setFillColor(sf::Color::White);
       window.draw(timeLabel);
@@ -659,8 +1344,18 @@ int main() {
       };
 
       if (currentView == CHART_VIEW) {
-        drawLegendItem("Factual Claim (Truth)", sf::Color::Blue, legendY + 30);
-        drawLegendItem("Misinfo Claim 1", sf::Color::Red, legendY + 50);
+        const size_t MAX_LEGEND_CLAIMS = 12;
+        const auto &all = chart.all();
+        for (size_t k = 0; k < all.size() && k < MAX_LEGEND_CLAIMS; ++k) {
+          std::string label =
+              (all[k].misinfo ? "Misinfo Claim " : "Truth Claim ") +
+              std::to_string(all[k].claimId);
+          drawLegendItem(label, all[k].color, legendY + 30 + 20 * k);
+        }
+        if (all.size() > MAX_LEGEND_CLAIMS)
+          drawLegendItem(
+              "+" + std::to_string(all.size() - MAX_LEGEND_CLAIMS) + " more",
+              sf::Color(100, 100, 100), legendY + 30 + 20 * MAX_LEGEND_CLAIMS);
       } else {
         drawLegendItem("Misinfo (Propagating)", sf::Color::Red, legendY + 30);
         drawLegendItem("Truth (Propagating)", sf::Color::Blue, legendY + 50);
@@ -684,5 +1379,8 @@ int main() {
 
     window.display();
   }
+  stopBuild = true;
+  if (builder.joinable())
+    builder.join();
   return 0;
 }